@@ -0,0 +1,57 @@
+#include "allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace
+{
+
+std::atomic<size_t> current{0};
+std::atomic<size_t> peak{0};
+
+}
+
+void* operator new(size_t size)
+{
+    if(void* ptr = std::malloc(size))
+    {
+        const size_t now = current.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed) + malloc_usable_size(ptr);
+        size_t max = peak.load(std::memory_order_relaxed);
+        while(now > max && !peak.compare_exchange_weak(max, now, std::memory_order_relaxed))
+            ;
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    current.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace bench
+{
+
+size_t allocated_bytes() noexcept
+{
+    return current.load(std::memory_order_relaxed);
+}
+
+size_t peak_bytes() noexcept
+{
+    return peak.load(std::memory_order_relaxed);
+}
+
+void reset_peak_bytes() noexcept
+{
+    peak.store(current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,20 @@
+#ifndef INI_BENCH_ALLOCATIONS_H
+#define INI_BENCH_ALLOCATIONS_H
+
+#include <cstddef>
+
+namespace bench
+{
+
+//! Bytes currently allocated through global operator new, including allocator overhead
+size_t allocated_bytes() noexcept;
+
+//! Maximum of allocated_bytes() since the last reset_peak_bytes()
+size_t peak_bytes() noexcept;
+
+//! Start measuring peak from the current number of allocated bytes
+void reset_peak_bytes() noexcept;
+
+}
+
+#endif //INI_BENCH_ALLOCATIONS_H
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "value.h"
+
+namespace
+{
+
+//! Conversion the way it was done before from_chars fast path
+template <typename T>
+T stream_as(const std::string& str)
+{
+    std::istringstream iss(str);
+    T res;
+    iss >> res;
+    if(iss.fail())
+        throw ini::not_convertible();
+    return res;
+}
+
+template <typename T>
+const ini::Value& sample();
+
+template <>
+const ini::Value& sample<int>()
+{
+    static const ini::Value res("1234567");
+    return res;
+}
+
+template <>
+const ini::Value& sample<double>()
+{
+    static const ini::Value res("12345.6789");
+    return res;
+}
+
+template <>
+const ini::Value& sample<bool>()
+{
+    static const ini::Value res("true");
+    return res;
+}
+
+template <>
+const ini::Value& sample<std::string>()
+{
+    static const ini::Value res("\"a quoted string with \\\"escaped\\\" quotes\"");
+    return res;
+}
+
+template <typename T>
+void BM_ValueAs(benchmark::State& state)
+{
+    const ini::Value& value = sample<T>();
+    for(auto _: state)
+        benchmark::DoNotOptimize(value.as<T>());
+}
+
+template <typename T>
+void BM_StreamAs(benchmark::State& state)
+{
+    const std::string str = sample<T>().template as<std::string>();
+    for(auto _: state)
+        benchmark::DoNotOptimize(stream_as<T>(str));
+}
+
+const ini::Value& int_array()
+{
+    static const ini::Value res([]
+    {
+        std::string str = "[";
+        for(int i = 0; i < 100000; ++i)
+            str += std::to_string(i * 7919 % 100003) + ", ";
+        return str + "0]";
+    }());
+    return res;
+}
+
+//! Wide values take the path copying digits into a narrow buffer
+void BM_WideValueAs(benchmark::State& state)
+{
+    const ini::wValue value(L"1234567");
+    for(auto _: state)
+        benchmark::DoNotOptimize(value.as<int>());
+}
+
+void BM_ArrayAsVector(benchmark::State& state)
+{
+    const ini::Value& value = int_array();
+    for(auto _: state)
+        benchmark::DoNotOptimize(value.as<std::vector<int>>());
+    state.SetBytesProcessed(state.iterations() * value.as<std::string>().size());
+}
+
+void BM_ArrayAsBuffer(benchmark::State& state)
+{
+    const ini::Value& value = int_array();
+    std::vector<int> buffer(100001);
+    for(auto _: state)
+        benchmark::DoNotOptimize(value.as_array(buffer.data(), buffer.size()));
+    state.SetBytesProcessed(state.iterations() * value.as<std::string>().size());
+}
+
+int max_threads()
+{
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_ValueAs, int)->ThreadRange(1, max_threads())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamAs, int)->ThreadRange(1, max_threads())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ValueAs, double)->ThreadRange(1, max_threads())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamAs, double)->ThreadRange(1, max_threads())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ValueAs, bool)->ThreadRange(1, max_threads())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ValueAs, std::string);
+BENCHMARK(BM_WideValueAs);
+BENCHMARK(BM_ArrayAsVector);
+BENCHMARK(BM_ArrayAsBuffer);
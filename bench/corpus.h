@@ -0,0 +1,173 @@
+#ifndef INI_BENCH_CORPUS_H
+#define INI_BENCH_CORPUS_H
+
+#include <string>
+#include <string_view>
+
+namespace bench
+{
+
+/**
+ * Shape of generated ini text
+ */
+enum class corpus_shape
+{
+    many_small_sections,    //!< inventory-like: thousands of sections with a few short values
+    few_huge_sections,      //!< four sections holding all values
+    long_values,            //!< values of several kilobytes
+    big_arrays,             //!< arrays of a thousand numbers and strings
+    comment_heavy           //!< mostly comment lines and values with trailing comments
+};
+
+namespace details
+{
+
+template <typename CharT>
+void append(std::basic_string<CharT>& res, std::string_view ascii)
+{
+    res.append(ascii.begin(), ascii.end());
+}
+
+template <typename CharT>
+void append(std::basic_string<CharT>& res, size_t number)
+{
+    append(res, std::to_string(number));
+}
+
+//! Text of a value, wide corpora get non ASCII characters which take slow paths of the lexer
+template <typename CharT>
+void append_text(std::basic_string<CharT>& res, size_t i)
+{
+    if constexpr (sizeof(CharT) > 1)
+        res += i % 2 ? L"значение " : L"値 ";
+    append(res, "value of option ");
+    append(res, i);
+}
+
+}
+
+/**
+ * @brief Generate text of about size characters, the same for every call
+ * @tparam CharT char for narrow and wchar_t for wide files
+ */
+template <typename CharT>
+std::basic_string<CharT> generate(corpus_shape shape, size_t size)
+{
+    using details::append;
+
+    std::basic_string<CharT> res;
+    res.reserve(size + 4096);
+    size_t section = 0;
+    size_t value = 0;
+    const auto new_section = [&]
+    {
+        append(res, "[section_");
+        append(res, section++);
+        append(res, "]\n");
+    };
+
+    switch(shape)
+    {
+    case corpus_shape::many_small_sections:
+        while(res.size() < size)
+        {
+            new_section();
+            append(res, "address = 10.0.");
+            append(res, section % 256);
+            append(res, ".1\nport = ");
+            append(res, 1000 + section % 50000);
+            append(res, "\nname = ");
+            details::append_text(res, section);
+            append(res, "\n");
+        }
+        break;
+    case corpus_shape::few_huge_sections:
+        for(size_t i = 0; i < 4; ++i)
+        {
+            new_section();
+            while(res.size() < size * (i + 1) / 4)
+            {
+                append(res, "key_");
+                append(res, value * 7919 % 1000003);
+                append(res, " = ");
+                append(res, value++);
+                append(res, "\n");
+            }
+        }
+        break;
+    case corpus_shape::long_values:
+        while(res.size() < size)
+        {
+            new_section();
+            for(size_t i = 0; i < 4; ++i)
+            {
+                append(res, "text_");
+                append(res, i);
+                append(res, " = \"");
+                for(size_t j = 0; j < 200; ++j)
+                {
+                    details::append_text(res, j);
+                    append(res, j % 50 ? ", " : ", \\\"quoted\\\" ");
+                }
+                append(res, "\"\n");
+            }
+        }
+        break;
+    case corpus_shape::big_arrays:
+        while(res.size() < size)
+        {
+            new_section();
+            append(res, "numbers = [");
+            for(size_t i = 0; i < 1000; ++i)
+            {
+                append(res, i * 7919 % 100003);
+                append(res, ", ");
+            }
+            append(res, "0]\nstrings = [");
+            for(size_t i = 0; i < 200; ++i)
+            {
+                append(res, "\"");
+                details::append_text(res, i);
+                append(res, "\", ");
+            }
+            append(res, "\"last\"]\n");
+        }
+        break;
+    case corpus_shape::comment_heavy:
+        append(res, "; generated configuration\n;\n");
+        while(res.size() < size)
+        {
+            new_section();
+            for(size_t i = 0; i < 4; ++i)
+            {
+                append(res, "; description of the next value, which is rather long as comments usually are\n");
+                append(res, "   ;   indented comment\n\n");
+                append(res, "option_");
+                append(res, i);
+                append(res, " = ");
+                append(res, i);
+                append(res, " ; trailing comment\n");
+            }
+        }
+        break;
+    }
+    return res;
+}
+
+//! Names of shapes for benchmark labels
+inline const char* shape_name(corpus_shape shape)
+{
+    switch(shape)
+    {
+    case corpus_shape::many_small_sections: return "many_small_sections";
+    case corpus_shape::few_huge_sections: return "few_huge_sections";
+    case corpus_shape::long_values: return "long_values";
+    case corpus_shape::big_arrays: return "big_arrays";
+    case corpus_shape::comment_heavy: return "comment_heavy";
+    }
+    return "";
+}
+
+}
+
+#endif //INI_BENCH_CORPUS_H
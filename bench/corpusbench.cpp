@@ -0,0 +1,199 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "parser.h"
+#include "interpolate.h"
+#include "corpus.h"
+#include "allocations.h"
+
+namespace
+{
+
+constexpr size_t corpus_size = 8 * 1024 * 1024;
+
+//! Corpora are generated once per shape and character type
+template <typename CharT>
+const std::basic_string<CharT>& corpus(bench::corpus_shape shape)
+{
+    static std::map<bench::corpus_shape, std::basic_string<CharT>> cache;
+    auto it = cache.find(shape);
+    if(it == cache.end())
+        it = cache.emplace(shape, bench::generate<CharT>(shape, corpus_size)).first;
+    return it->second;
+}
+
+/**
+ * Parse corpus into a File owning its strings
+ * Reports throughput in bytes of text and peak memory used by the file and parsing temporaries.
+ */
+template <typename CharT, typename Storage>
+void BM_ParseCorpus(benchmark::State& state, bench::corpus_shape shape)
+{
+    const auto& text = corpus<CharT>(shape);
+    size_t peak = 0;
+    for(auto _: state)
+    {
+        const size_t before = bench::allocated_bytes();
+        bench::reset_peak_bytes();
+        {
+            ini::File<std::basic_string<CharT>, Storage> file;
+            ini::parse(ini::syntax::line_iterator<CharT>(text.data(), text.data() + text.size()),
+                       ini::syntax::line_iterator<CharT>(), file);
+            benchmark::DoNotOptimize(&file);
+        }
+        peak = bench::peak_bytes() - before;
+    }
+    state.SetBytesProcessed(state.iterations() * text.size() * sizeof(CharT));
+    state.counters["peak_bytes"] = double(peak);
+    state.counters["peak_bytes_per_text_byte"] = double(peak) / double(text.size() * sizeof(CharT));
+}
+
+/**
+ * Split corpus into lines without parsing them
+ * @tparam Blocks true for line_iterator scanning blocks for line ends, false for a memchr() call per line
+ */
+template <bool Blocks>
+void BM_SplitLines(benchmark::State& state, bench::corpus_shape shape)
+{
+    const auto& text = corpus<char>(shape);
+    const char* first = text.data();
+    const char* last = first + text.size();
+    for(auto _: state)
+    {
+        size_t lines = 0;
+        if constexpr (Blocks)
+        {
+            for(ini::syntax::line_iterator<char> it(first, last), end; it != end; ++it)
+                lines += it->size();
+        }
+        else
+        {
+            for(const char* pos = first; pos != last;)
+            {
+                const char* end = static_cast<const char*>(std::memchr(pos, '\n', last - pos));
+                lines += (end ? end : last) - pos;
+                pos = end ? end + 1 : last;
+            }
+        }
+        benchmark::DoNotOptimize(lines);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+//! Transcode narrow corpus from UTF-8 or its UTF-16 encoding into wide characters
+void BM_DecodeCorpus(benchmark::State& state, bench::corpus_shape shape, ini::encoding type)
+{
+    std::string bytes = corpus<char>(shape);
+    if(type != ini::encoding::utf8)
+    {
+        const std::wstring wide = ini::decode<wchar_t>(bytes, ini::encoding::utf8);
+        bytes.clear();
+        for(wchar_t c: wide)
+        {
+            const char high = char(c >> 8), low = char(c & 0xFF);
+            bytes += type == ini::encoding::utf16be ? high : low;
+            bytes += type == ini::encoding::utf16be ? low : high;
+        }
+    }
+    for(auto _: state)
+        benchmark::DoNotOptimize(ini::decode<wchar_t>(bytes, type));
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+//! Section::get<int>() of random values of a huge section, the way settings are usually read
+template <typename Storage>
+void BM_SectionGet(benchmark::State& state)
+{
+    const auto& text = corpus<char>(bench::corpus_shape::few_huge_sections);
+    ini::File<std::string, Storage> file;
+    ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+               ini::syntax::line_iterator<char>(), file);
+    const auto& section = file.at("section_0");
+
+    std::mt19937 gen(1);
+    std::vector<std::string> names;
+    for(size_t i = 0; i < 1024; ++i)
+    {
+        auto it = section.begin();
+        std::advance(it, gen() % std::min<size_t>(section.size(), 4096));
+        names.emplace_back(it->first);
+    }
+
+    size_t i = 0;
+    for(auto _: state)
+        benchmark::DoNotOptimize(section.template get<int>(names[i++ & 1023]));
+}
+
+/**
+ * Interpolate chains of references, every value refers to the previous one of its chain
+ * @param state.range(0) number of values, state.range(1) length of chains
+ */
+void BM_Interpolate(benchmark::State& state)
+{
+    const size_t count = state.range(0), length = state.range(1);
+    std::string text = "[values]\n";
+    for(size_t i = 0; i < count; ++i)
+    {
+        text += "key_" + std::to_string(i) + " = ";
+        text += i % length ? "${key_" + std::to_string(i - 1) + "}/" + std::to_string(i) + "\n" : "root\n";
+    }
+    ini::File<std::string> parsed;
+    ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+               ini::syntax::line_iterator<char>(), parsed);
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        ini::File<std::string> file = parsed;
+        state.ResumeTiming();
+        ini::interpolate(file);
+        benchmark::DoNotOptimize(&file);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template <typename CharT, typename Storage>
+void register_corpus(const std::string& name, std::initializer_list<bench::corpus_shape> shapes)
+{
+    for(bench::corpus_shape shape: shapes)
+        benchmark::RegisterBenchmark((name + "/" + bench::shape_name(shape)).c_str(), BM_ParseCorpus<CharT, Storage>, shape)
+                ->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+const bool corpora_registered = []
+{
+    using shape = bench::corpus_shape;
+    const auto all = {shape::many_small_sections, shape::few_huge_sections, shape::long_values, shape::big_arrays,
+                      shape::comment_heavy};
+    register_corpus<char, ini::ordered_storage>("BM_ParseCorpus<char, ordered_storage>", all);
+    register_corpus<char, ini::hash_storage>("BM_ParseCorpus<char, hash_storage>", all);
+    register_corpus<wchar_t, ini::ordered_storage>("BM_ParseCorpus<wchar_t, ordered_storage>", all);
+    for(shape s: all)
+    {
+        benchmark::RegisterBenchmark((std::string("BM_SplitLines<blocks>/") + bench::shape_name(s)).c_str(),
+                                     BM_SplitLines<true>, s);
+        benchmark::RegisterBenchmark((std::string("BM_SplitLines<memchr>/") + bench::shape_name(s)).c_str(),
+                                     BM_SplitLines<false>, s);
+    }
+    for(auto type: {ini::encoding::utf8, ini::encoding::utf16le, ini::encoding::utf16be})
+    {
+        const char* names[] = {"utf8", "utf16le", "utf16be"};
+        for(shape s: {shape::many_small_sections, shape::long_values})
+            benchmark::RegisterBenchmark((std::string("BM_DecodeCorpus/") + names[int(type)] + "/" + bench::shape_name(s)).c_str(),
+                                         BM_DecodeCorpus, s, type);
+    }
+    return true;
+}();
+
+}
+
+BENCHMARK_TEMPLATE(BM_SectionGet, ini::ordered_storage);
+BENCHMARK_TEMPLATE(BM_SectionGet, ini::flat_storage);
+BENCHMARK_TEMPLATE(BM_SectionGet, ini::hash_storage);
+BENCHMARK(BM_Interpolate)->Args({10000, 1})->Args({10000, 10})->Args({10000, 1000})
+        ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "parser.h"
+#include "parallel.h"
+#include "lazyfile.h"
+#include "snapshot.h"
+#include "viewfile.h"
+
+namespace
+{
+
+//! Inventory with many small sections, about 100 MB
+const std::string& inventory()
+{
+    static const std::string res = []
+    {
+        std::string text;
+        for(size_t i = 0; i < 400000; ++i)
+        {
+            text += "[host_" + std::to_string(i) + "]\n";
+            text += "address = 10." + std::to_string(i / 65536 % 256) + "." + std::to_string(i / 256 % 256) + "." +
+                    std::to_string(i % 256) + "\n";
+            text += "port = " + std::to_string(1000 + i % 50000) + "\n";
+            for(size_t j = 0; j < 8; ++j)
+                text += "option_" + std::to_string(j) + " = value of option " + std::to_string(j) + "\n";
+        }
+        return text;
+    }();
+    return res;
+}
+
+void BM_Parse(benchmark::State& state)
+{
+    const std::string& text = inventory();
+    for(auto _: state)
+    {
+        ini::File<std::string_view, ini::hash_storage> file;
+        ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                   ini::syntax::line_iterator<char>(), file);
+        benchmark::DoNotOptimize(&file);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+void BM_ParseParallel(benchmark::State& state)
+{
+    const std::string& text = inventory();
+    for(auto _: state)
+    {
+        ini::File<std::string_view, ini::hash_storage> file;
+        ini::parse_parallel(std::string_view(text), file, state.range(0));
+        benchmark::DoNotOptimize(&file);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+//! Inventory written to a temporary file
+const std::string& inventory_file()
+{
+    static const std::string res = []
+    {
+        std::string filename = (std::filesystem::temp_directory_path() / "ini_parser_inventory.ini").string();
+        std::ofstream(filename) << inventory();
+        return filename;
+    }();
+    return res;
+}
+
+void BM_LazyLoad(benchmark::State& state)
+{
+    const std::string& filename = inventory_file();
+    for(auto _: state)
+    {
+        ini::LazyFile<std::string_view, ini::hash_storage> file(filename);
+        benchmark::DoNotOptimize(&file.at("host_12345"));
+    }
+    state.SetBytesProcessed(state.iterations() * inventory().size());
+}
+
+//! Cold start from text: map and parse the whole file
+void BM_StartFromText(benchmark::State& state)
+{
+    const std::string& filename = inventory_file();
+    for(auto _: state)
+    {
+        ini::ViewFile file(filename);
+        benchmark::DoNotOptimize(file.at("host_12345").at("port").as<int>());
+    }
+}
+
+//! Cold start from snapshot: map image, check that it is current and look up a value
+void BM_StartFromSnapshot(benchmark::State& state)
+{
+    const std::string& filename = inventory_file();
+    const std::string snapshot_filename = filename + ".snap";
+    ini::load_snapshot(filename, snapshot_filename);
+    for(auto _: state)
+    {
+        ini::Snapshot snapshot = ini::load_snapshot(filename, snapshot_filename);
+        benchmark::DoNotOptimize(snapshot.at("host_12345").at("port").as<int>());
+    }
+}
+
+}
+
+BENCHMARK(BM_Parse)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ParseParallel)->RangeMultiplier(2)->Range(1, std::max(1u, std::thread::hardware_concurrency()))
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LazyLoad)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_StartFromText)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_StartFromSnapshot)->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "parser.h"
+#include "allocations.h"
+
+namespace
+{
+
+constexpr size_t sections_count = 64;
+
+std::string key_name(size_t i)
+{
+    return "key_" + std::to_string(i * 7919 % 100003);
+}
+
+std::string generate(size_t keys_per_section)
+{
+    std::string res;
+    for(size_t s = 0; s < sections_count; ++s)
+    {
+        res += "[section_" + std::to_string(s) + "]\n";
+        for(size_t k = 0; k < keys_per_section; ++k)
+            res += key_name(k) + " = " + std::to_string(k) + "\n";
+    }
+    return res;
+}
+
+template <typename Storage>
+ini::File<std::string, Storage> load(const std::string& text)
+{
+    std::istringstream iss(text);
+    ini::File<std::string, Storage> file;
+    ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), file);
+    return file;
+}
+
+template <typename Storage>
+void BM_Lookup(benchmark::State& state)
+{
+    const size_t keys_per_section = state.range(0);
+    const std::string text = generate(keys_per_section);
+
+    const size_t before = bench::allocated_bytes();
+    auto file = load<Storage>(text);
+    const size_t file_bytes = bench::allocated_bytes() - before;
+
+    std::mt19937 gen(1);
+    std::vector<std::pair<std::string, std::string>> queries;
+    for(size_t i = 0; i < 1024; ++i)
+        queries.emplace_back("section_" + std::to_string(gen() % sections_count), key_name(gen() % keys_per_section));
+
+    size_t i = 0;
+    for(auto _: state)
+    {
+        const auto& query = queries[i++ & 1023];
+        benchmark::DoNotOptimize(&file.at(query.first).at(query.second));
+    }
+
+    state.counters["bytes_per_entry"] = double(file_bytes) / double(sections_count * keys_per_section);
+}
+
+template <typename Storage>
+void BM_KeyLookup(benchmark::State& state)
+{
+    const size_t keys_per_section = state.range(0);
+    const std::string text = generate(keys_per_section);
+    auto file = load<Storage>(text);
+
+    std::mt19937 gen(1);
+    std::vector<std::string> names;
+    std::vector<std::pair<ini::key, ini::key>> queries;
+    names.reserve(2048);
+    for(size_t i = 0; i < 1024; ++i)
+    {
+        names.push_back("section_" + std::to_string(gen() % sections_count));
+        names.push_back(key_name(gen() % keys_per_section));
+        queries.emplace_back(ini::key(names[2 * i]), ini::key(names[2 * i + 1]));
+    }
+
+    size_t i = 0;
+    const size_t before = bench::allocated_bytes();
+    for(auto _: state)
+    {
+        const auto& query = queries[i++ & 1023];
+        benchmark::DoNotOptimize(&file.at(query.first).at(query.second));
+    }
+
+    state.counters["allocated_bytes"] = double(bench::allocated_bytes() - before);
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_Lookup, ini::ordered_storage)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Lookup, ini::flat_storage)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_Lookup, ini::hash_storage)->RangeMultiplier(8)->Range(8, 4096);
+
+BENCHMARK_TEMPLATE(BM_KeyLookup, ini::ordered_storage)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_KeyLookup, ini::flat_storage)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_KeyLookup, ini::hash_storage)->RangeMultiplier(8)->Range(8, 4096);
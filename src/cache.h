@@ -0,0 +1,206 @@
+#ifndef INI_CACHE_H
+#define INI_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace ini
+{
+
+/**
+ * Hit and miss counters of all value conversion caches
+ */
+struct cache_statistics
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+namespace details
+{
+
+//! Small sequential number of the calling thread
+inline size_t thread_index() noexcept
+{
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+/**
+ * Counter split into cache line sized shards so that concurrent threads don't contend on one atomic
+ */
+class sharded_counter
+{
+public:
+    void increment() noexcept
+    {
+        m_shards[thread_index() % shards_count].value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const noexcept
+    {
+        uint64_t res = 0;
+        for(const shard& s: m_shards)
+            res += s.value.load(std::memory_order_relaxed);
+        return res;
+    }
+
+    void reset() noexcept
+    {
+        for(shard& s: m_shards)
+            s.value.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t shards_count = 16;
+
+    struct alignas(64) shard
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    shard m_shards[shards_count];
+};
+
+inline sharded_counter& cache_hits()
+{
+    static sharded_counter res;
+    return res;
+}
+
+inline sharded_counter& cache_misses()
+{
+    static sharded_counter res;
+    return res;
+}
+
+//! Unique identifier of a type without RTTI
+template <typename T>
+const void* type_id() noexcept
+{
+    static const char id = 0;
+    return &id;
+}
+
+/**
+ * Lock-free cache of conversion results keyed by type
+ * Results are kept in a singly linked list which only grows, so readers never wait.
+ * Copies start empty, assignment drops all results.
+ */
+class conversion_cache
+{
+public:
+    conversion_cache() noexcept = default;
+    conversion_cache(const conversion_cache&) noexcept {}
+    conversion_cache(conversion_cache&& other) noexcept
+        : m_head(other.m_head.exchange(nullptr, std::memory_order_relaxed)) {}
+
+    conversion_cache& operator=(const conversion_cache&) noexcept
+    {
+        clear();
+        return *this;
+    }
+
+    conversion_cache& operator=(conversion_cache&& other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            m_head.store(other.m_head.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    ~conversion_cache() { clear(); }
+
+    /**
+     * @brief Get cached result of type T or store result of convert()
+     * Concurrent calls may convert simultaneously, only one result is kept
+     * @return reference valid until the cache is cleared or destroyed
+     */
+    template <typename T, typename Convert>
+    const T& get(Convert&& convert) const
+    {
+        node* head = m_head.load(std::memory_order_acquire);
+        if(const T* res = find<T>(head, nullptr))
+        {
+            cache_hits().increment();
+            return *res;
+        }
+        cache_misses().increment();
+
+        auto* created = new typed_node<T>(convert());
+        created->type = type_id<T>();
+        created->next = head;
+        while(!m_head.compare_exchange_weak(created->next, created, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            // somebody else added results, check whether one of them is T
+            if(const T* res = find<T>(created->next, head))
+            {
+                delete created;
+                return *res;
+            }
+            head = created->next;
+        }
+        return created->value;
+    }
+
+    //! Drop all results, must not be called concurrently with get()
+    void clear() noexcept
+    {
+        node* head = m_head.exchange(nullptr, std::memory_order_acquire);
+        while(head)
+            delete std::exchange(head, head->next);
+    }
+
+private:
+    struct node
+    {
+        virtual ~node() = default;
+
+        const void* type = nullptr;
+        node* next = nullptr;
+    };
+
+    template <typename T>
+    struct typed_node : node
+    {
+        explicit typed_node(T&& v) : value(std::move(v)) {}
+        T value;
+    };
+
+    //! Search list from first until last
+    template <typename T>
+    static const T* find(node* first, node* last) noexcept
+    {
+        for(; first != last; first = first->next)
+            if(first->type == type_id<T>())
+                return &static_cast<typed_node<T>*>(first)->value;
+        return nullptr;
+    }
+
+    mutable std::atomic<node*> m_head{nullptr};
+};
+
+}
+
+//! Sum of hits and misses of all conversion caches since start or last reset
+inline cache_statistics conversion_cache_statistics() noexcept
+{
+    cache_statistics res;
+    res.hits = details::cache_hits().load();
+    res.misses = details::cache_misses().load();
+    return res;
+}
+
+inline void reset_conversion_cache_statistics() noexcept
+{
+    details::cache_hits().reset();
+    details::cache_misses().reset();
+}
+
+}
+
+#endif //INI_CACHE_H
@@ -0,0 +1,180 @@
+#ifndef INI_DIFF_H
+#define INI_DIFF_H
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include "parser.h"
+
+namespace ini
+{
+
+/**
+ * Kind of difference between two files
+ */
+enum class change_type
+{
+    section_added,
+    section_removed,
+    value_added,
+    value_removed,
+    value_changed
+};
+
+/**
+ * Single difference between two files
+ * Views refer to the compared files and are valid while they live.
+ * Changes of values inside added or removed sections are not listed.
+ */
+template <typename S>
+struct change
+{
+    using view_type = std::basic_string_view<typename S::value_type, typename S::traits_type>;
+
+    change_type type;
+    view_type section;
+    view_type name;         //!< empty for section changes
+    view_type old_value;    //!< empty unless value is removed or changed
+    view_type new_value;    //!< empty unless value is added or changed
+};
+
+namespace details
+{
+
+template <typename String>
+std::basic_string_view<typename String::value_type, typename String::traits_type> key_view(const String& key) noexcept
+{
+    return key;
+}
+
+template <typename Entry>
+const Entry& entry_of(const Entry& entry) noexcept { return entry; }
+
+template <typename Entry>
+const Entry& entry_of(const Entry* entry) noexcept { return *entry; }
+
+/**
+ * @brief Call f with a range of entries of map sorted by key
+ * Sorted storages are walked directly, others get a sorted array of pointers to their entries
+ */
+template <typename Storage, typename Map, typename F>
+void with_sorted(const Map& map, F f)
+{
+    if constexpr (Storage::sorted)
+    {
+        f(map.begin(), map.end());
+    }
+    else
+    {
+        using entry = typename std::iterator_traits<decltype(map.begin())>::value_type;
+        std::vector<const entry*> entries;
+        for(const entry& e: map)
+            entries.push_back(&e);
+        std::sort(entries.begin(), entries.end(), [](const entry* l, const entry* r)
+        {
+            return key_view(l->first) < key_view(r->first);
+        });
+        f(entries.cbegin(), entries.cend());
+    }
+}
+
+/**
+ * @brief Walk two sorted ranges at once calling added(), removed() or both() for every key
+ */
+template <typename LeftIter, typename RightIter, typename Removed, typename Added, typename Both>
+void merge_walk(LeftIter l_first, LeftIter l_last, RightIter r_first, RightIter r_last,
+                Removed removed, Added added, Both both)
+{
+    while(l_first != l_last && r_first != r_last)
+    {
+        const auto& l = entry_of(*l_first);
+        const auto& r = entry_of(*r_first);
+        const int cmp = key_view(l.first).compare(key_view(r.first));
+        if(cmp < 0)
+        {
+            removed(l);
+            ++l_first;
+        }
+        else if(cmp > 0)
+        {
+            added(r);
+            ++r_first;
+        }
+        else
+        {
+            both(l, r);
+            ++l_first;
+            ++r_first;
+        }
+    }
+    for(; l_first != l_last; ++l_first)
+        removed(entry_of(*l_first));
+    for(; r_first != r_last; ++r_first)
+        added(entry_of(*r_first));
+}
+
+}
+
+/**
+ * @brief List differences between two versions of a file
+ * Sections and values are matched by a linear walk in key order. Sections with equal content hashes and sizes
+ * are considered equal without comparing their values.
+ * Changes are ordered by section name and then by value name.
+ */
+template <typename S, typename Storage>
+std::vector<change<S>> diff(const File<S, Storage>& from, const File<S, Storage>& to)
+{
+    using view_type = typename change<S>::view_type;
+
+    std::vector<change<S>> res;
+    details::with_sorted<Storage>(from, [&](auto from_first, auto from_last)
+    {
+        details::with_sorted<Storage>(to, [&](auto to_first, auto to_last)
+        {
+            details::merge_walk(from_first, from_last, to_first, to_last,
+            [&res](const auto& section)
+            {
+                res.push_back({change_type::section_removed, view_type(section.first), {}, {}, {}});
+            },
+            [&res](const auto& section)
+            {
+                res.push_back({change_type::section_added, view_type(section.first), {}, {}, {}});
+            },
+            [&res](const auto& old_section, const auto& new_section)
+            {
+                if(old_section.second.content_hash() == new_section.second.content_hash() &&
+                   old_section.second.size() == new_section.second.size())
+                    return;
+                const view_type name(old_section.first);
+                details::with_sorted<Storage>(old_section.second, [&](auto old_first, auto old_last)
+                {
+                    details::with_sorted<Storage>(new_section.second, [&](auto new_first, auto new_last)
+                    {
+                        details::merge_walk(old_first, old_last, new_first, new_last,
+                        [&](const auto& value)
+                        {
+                            res.push_back({change_type::value_removed, name, view_type(value.first),
+                                           value.second.view(), {}});
+                        },
+                        [&](const auto& value)
+                        {
+                            res.push_back({change_type::value_added, name, view_type(value.first),
+                                           {}, value.second.view()});
+                        },
+                        [&](const auto& old_value, const auto& new_value)
+                        {
+                            if(old_value.second.view() != new_value.second.view())
+                                res.push_back({change_type::value_changed, name, view_type(old_value.first),
+                                               old_value.second.view(), new_value.second.view()});
+                        });
+                    });
+                });
+            });
+        });
+    });
+    return res;
+}
+
+}
+
+#endif //INI_DIFF_H
@@ -0,0 +1,395 @@
+#ifndef INI_ENCODING_H
+#define INI_ENCODING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "errors.h"
+#include "scan.h"
+
+namespace ini
+{
+
+/**
+ * Encoding of a text file
+ */
+enum class encoding
+{
+    utf8,
+    utf16le,
+    utf16be
+};
+
+struct detected_encoding
+{
+    encoding type = encoding::utf8;
+    size_t bom_size = 0;    //!< bytes of byte order mark to skip
+};
+
+/**
+ * @brief Detect encoding by byte order mark
+ * Without a mark, a zero among the first two bytes means UTF-16 with an ASCII first character,
+ * which is what every ini file starts with; everything else is UTF-8.
+ */
+inline detected_encoding detect_encoding(std::string_view bytes) noexcept
+{
+    const auto byte = [&bytes](size_t i) { return static_cast<unsigned char>(bytes[i]); };
+    if(bytes.size() >= 3 && byte(0) == 0xEF && byte(1) == 0xBB && byte(2) == 0xBF)
+        return {encoding::utf8, 3};
+    if(bytes.size() >= 2 && byte(0) == 0xFF && byte(1) == 0xFE)
+        return {encoding::utf16le, 2};
+    if(bytes.size() >= 2 && byte(0) == 0xFE && byte(1) == 0xFF)
+        return {encoding::utf16be, 2};
+    if(bytes.size() >= 2 && byte(0) != 0 && byte(1) == 0)
+        return {encoding::utf16le, 0};
+    if(bytes.size() >= 2 && byte(0) == 0 && byte(1) != 0)
+        return {encoding::utf16be, 0};
+    return {};
+}
+
+namespace details
+{
+
+/**
+ * Append code point to out in the encoding of CharT
+ * char is UTF-8, wchar_t is UTF-32 or UTF-16 depending on its size
+ */
+template <typename CharT>
+CharT* put_code_point(CharT* out, uint32_t cp) noexcept
+{
+    if constexpr (sizeof(CharT) == 1)
+    {
+        if(cp < 0x80)
+            *out++ = CharT(cp);
+        else if(cp < 0x800)
+        {
+            *out++ = CharT(0xC0 | cp >> 6);
+            *out++ = CharT(0x80 | (cp & 0x3F));
+        }
+        else if(cp < 0x10000)
+        {
+            *out++ = CharT(0xE0 | cp >> 12);
+            *out++ = CharT(0x80 | (cp >> 6 & 0x3F));
+            *out++ = CharT(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            *out++ = CharT(0xF0 | cp >> 18);
+            *out++ = CharT(0x80 | (cp >> 12 & 0x3F));
+            *out++ = CharT(0x80 | (cp >> 6 & 0x3F));
+            *out++ = CharT(0x80 | (cp & 0x3F));
+        }
+    }
+    else if constexpr (sizeof(CharT) == 2)
+    {
+        if(cp < 0x10000)
+            *out++ = CharT(cp);
+        else
+        {
+            *out++ = CharT(0xD800 + ((cp - 0x10000) >> 10));
+            *out++ = CharT(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        }
+    }
+    else
+        *out++ = CharT(cp);
+    return out;
+}
+
+/**
+ * @brief Decode one UTF-8 sequence, rejecting overlong forms, surrogates and code points above U+10FFFF
+ * @throw ini::invalid_encoding if sequence is malformed
+ */
+inline uint32_t next_utf8(const unsigned char*& in, const unsigned char* first, const unsigned char* last)
+{
+    const unsigned char c = *in;
+    size_t size;
+    uint32_t cp;
+    unsigned char min = 0x80, max = 0xBF;
+    if(c < 0x80)
+    {
+        ++in;
+        return c;
+    }
+    else if(c >= 0xC2 && c <= 0xDF)
+    {
+        size = 2;
+        cp = c & 0x1F;
+    }
+    else if(c >= 0xE0 && c <= 0xEF)
+    {
+        size = 3;
+        cp = c & 0x0F;
+        min = c == 0xE0 ? 0xA0 : 0x80;
+        max = c == 0xED ? 0x9F : 0xBF;
+    }
+    else if(c >= 0xF0 && c <= 0xF4)
+    {
+        size = 4;
+        cp = c & 0x07;
+        min = c == 0xF0 ? 0x90 : 0x80;
+        max = c == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+        throw invalid_encoding(in - first, "invalid UTF-8 lead byte");
+
+    if(size_t(last - in) < size)
+        throw invalid_encoding(in - first, "truncated UTF-8 sequence");
+    for(size_t i = 1; i < size; ++i)
+    {
+        const unsigned char next = in[i];
+        if(next < min || next > max)
+            throw invalid_encoding(in - first, "invalid UTF-8 continuation byte");
+        cp = cp << 6 | (next & 0x3F);
+        min = 0x80;
+        max = 0xBF;
+    }
+    in += size;
+    return cp;
+}
+
+template <bool BigEndian>
+uint32_t utf16_unit(const unsigned char* in) noexcept
+{
+    return BigEndian ? uint32_t(in[0]) << 8 | in[1] : uint32_t(in[1]) << 8 | in[0];
+}
+
+/**
+ * @brief Decode one UTF-16 code point
+ * @throw ini::invalid_encoding on unpaired surrogates
+ */
+template <bool BigEndian>
+uint32_t next_utf16(const unsigned char*& in, const unsigned char* first, const unsigned char* last)
+{
+    const uint32_t unit = utf16_unit<BigEndian>(in);
+    if(unit < 0xD800 || unit > 0xDFFF)
+    {
+        in += 2;
+        return unit;
+    }
+    if(unit > 0xDBFF || last - in < 4)
+        throw invalid_encoding(in - first, "unpaired UTF-16 surrogate");
+    const uint32_t low = utf16_unit<BigEndian>(in + 2);
+    if(low < 0xDC00 || low > 0xDFFF)
+        throw invalid_encoding(in - first, "unpaired UTF-16 surrogate");
+    in += 4;
+    return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+}
+
+#ifdef INI_PARSER_SSE2
+//! Store 16 ASCII bytes or 8 code units below U+D800 widened to CharT
+template <typename CharT, size_t UnitSize>
+void store_widened(CharT* out, __m128i units) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    if constexpr (UnitSize == 1)
+    {
+        const __m128i low = _mm_unpacklo_epi8(units, zero);
+        const __m128i high = _mm_unpackhi_epi8(units, zero);
+        if constexpr (sizeof(CharT) == 2)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), high);
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_unpackhi_epi16(high, zero));
+        }
+    }
+    else if constexpr (sizeof(CharT) == 1)
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+    else if constexpr (sizeof(CharT) == 2)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), units);
+    else
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(units, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(units, zero));
+    }
+}
+#endif
+
+/**
+ * @brief Transcode UTF-8 into wide characters
+ * Blocks of 16 ASCII bytes are widened at once, others are decoded one code point at a time.
+ */
+template <typename CharT>
+CharT* decode_utf8(const unsigned char* first, const unsigned char* last, CharT* out)
+{
+    const unsigned char* in = first;
+    while(in != last)
+    {
+#ifdef INI_PARSER_SSE2
+        if(last - in >= 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if(_mm_movemask_epi8(block) == 0)
+            {
+                store_widened<CharT, 1>(out, block);
+                in += 16;
+                out += 16;
+                continue;
+            }
+        }
+#endif
+        // the rest of the block which was not ASCII
+        for(const unsigned char* stop = in + std::min<ptrdiff_t>(16, last - in); in < stop;)
+            out = put_code_point(out, next_utf8(in, first, last));
+    }
+    return out;
+}
+
+/**
+ * @brief Transcode UTF-16 of even size into UTF-8 or wide characters
+ * Blocks of 8 code units which need no conversion are stored at once.
+ */
+template <bool BigEndian, typename CharT>
+CharT* decode_utf16(const unsigned char* first, const unsigned char* last, CharT* out)
+{
+    const unsigned char* in = first;
+    while(in != last)
+    {
+#ifdef INI_PARSER_SSE2
+        if(last - in >= 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            if constexpr (BigEndian)
+                block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+            // UTF-8 takes ASCII blocks, wide characters take everything below surrogates
+            const __m128i mask = _mm_set1_epi16(sizeof(CharT) == 1 ? int16_t(0xFF80) : int16_t(0xF800));
+            const __m128i masked = _mm_and_si128(block, mask);
+            const __m128i plain = sizeof(CharT) == 1 ? _mm_cmpeq_epi16(masked, _mm_setzero_si128())
+                                                     : _mm_xor_si128(_mm_cmpeq_epi16(masked, _mm_set1_epi16(int16_t(0xD800))),
+                                                                     _mm_set1_epi8(-1));
+            if(_mm_movemask_epi8(plain) == 0xFFFF)
+            {
+                store_widened<CharT, 2>(out, block);
+                in += 16;
+                out += 8;
+                continue;
+            }
+        }
+#endif
+        for(const unsigned char* stop = in + std::min<ptrdiff_t>(16, last - in); in < stop;)
+            out = put_code_point(out, next_utf16<BigEndian>(in, first, last));
+    }
+    return out;
+}
+
+}
+
+/**
+ * @brief Transcode text into the encoding of CharT
+ * char is UTF-8, which is copied without validation; wchar_t is UTF-32 or UTF-16 depending on its size.
+ * @param bytes text without byte order mark
+ * @throw ini::invalid_encoding if text is malformed
+ */
+template <typename CharT>
+std::basic_string<CharT> decode(std::string_view bytes, encoding type)
+{
+    static_assert(std::is_same<CharT, char>::value || std::is_same<CharT, wchar_t>::value,
+                  "only char and wchar_t are supported by the syntax traits");
+
+    if constexpr (std::is_same<CharT, char>::value)
+        if(type == encoding::utf8)
+            return std::string(bytes);
+
+    const auto first = reinterpret_cast<const unsigned char*>(bytes.data());
+    const auto last = first + bytes.size();
+    if(type != encoding::utf8 && bytes.size() % 2)
+        throw invalid_encoding(bytes.size() - 1, "odd number of bytes in UTF-16 text");
+
+    // the longest output is 3 UTF-8 bytes per UTF-16 unit, otherwise a code unit per byte is enough
+    std::basic_string<CharT> res(type != encoding::utf8 && sizeof(CharT) == 1 ? bytes.size() / 2 * 3 : bytes.size(), CharT());
+    CharT* out = &res[0];
+    if(type == encoding::utf8)
+        out = details::decode_utf8(first, last, out);
+    else if(type == encoding::utf16le)
+        out = details::decode_utf16<false>(first, last, out);
+    else
+        out = details::decode_utf16<true>(first, last, out);
+    res.resize(out - res.data());
+    return res;
+}
+
+namespace details
+{
+
+//! Transcode text after the byte order mark, offsets of errors are counted from the beginning of bytes
+template <typename CharT>
+std::basic_string<CharT> decode_after_bom(std::string_view bytes, const detected_encoding& detected)
+{
+    try
+    {
+        return decode<CharT>(bytes.substr(detected.bom_size), detected.type);
+    }
+    catch(const invalid_encoding& e)
+    {
+        throw invalid_encoding(e.offset() + detected.bom_size, e.reason());
+    }
+}
+
+}
+
+/**
+ * @brief Detect encoding, skip byte order mark and transcode text into the encoding of CharT
+ * @throw ini::invalid_encoding if text is malformed, the offset includes the byte order mark
+ */
+template <typename CharT>
+std::basic_string<CharT> decode(std::string_view bytes)
+{
+    return details::decode_after_bom<CharT>(bytes, detect_encoding(bytes));
+}
+
+namespace details
+{
+
+//! Rest of contents of opened file
+inline std::string read_bytes(std::ifstream& ifs)
+{
+    std::string res;
+    ifs.seekg(0, std::ios::end);
+    const std::streamoff size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    if(size > 0)
+    {
+        res.resize(static_cast<size_t>(size));
+        ifs.read(&res[0], size);
+        res.resize(static_cast<size_t>(ifs.gcount()));
+    }
+    return res;
+}
+
+//! Contents of file, empty if it could not be read
+inline std::string read_bytes(const std::string& filename)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    return ifs ? read_bytes(ifs) : std::string();
+}
+
+/**
+ * @brief Pass text of bytes in the encoding of CharT to f
+ * UTF-8 for narrow characters is passed without copying, only the byte order mark is skipped
+ */
+template <typename CharT, typename F>
+decltype(auto) with_decoded(std::string_view bytes, F&& f)
+{
+    const detected_encoding detected = detect_encoding(bytes);
+    if constexpr (std::is_same<CharT, char>::value)
+        if(detected.type == encoding::utf8)
+            return f(bytes.substr(detected.bom_size));
+    const std::basic_string<CharT> text = decode_after_bom<CharT>(bytes, detected);
+    return f(std::basic_string_view<CharT>(text));
+}
+
+}
+
+}
+
+#endif //INI_ENCODING_H
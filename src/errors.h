@@ -1,12 +1,39 @@
 #ifndef INI_ERRORS_H
 #define INI_ERRORS_H
 
+#include <cstdint>
 #include <string>
 #include <exception>
+#include <vector>
 
 namespace ini
 {
 
+/**
+ * Kind of parsing error, named after the exception thrown for it
+ */
+enum class error_code
+{
+    parsing_fail,
+    out_of_section_declaration,
+    double_section_definition,
+    double_value_definition,
+    invalid_encoding        //!< file given to parse() is malformed, see invalid_encoding
+};
+
+/**
+ * Error found by parse() with std::nothrow, see parse_result
+ */
+struct diagnostic
+{
+    size_t line_no;         //!< 0 for invalid_encoding
+    uint32_t column;        //!< 1-based position of the offending token in the line, byte offset for invalid_encoding
+    error_code code;
+    uint32_t text_begin;    //!< texts of the message in parse_result: line, section name, section and value names or reason
+    uint32_t text_size;
+    uint32_t name_size;     //!< size of value name at the end of the text for double_value_definition
+};
+
 class not_convertible : public std::exception
 {
 public:
@@ -16,6 +43,123 @@ public:
     }
 };
 
+class invalid_snapshot : public std::exception
+{
+public:
+    explicit invalid_snapshot(const std::string& reason) noexcept
+    {
+        m_mes = "Invalid snapshot: " + reason;
+    }
+
+    const char* what() const noexcept override
+    {
+        return m_mes.c_str();
+    }
+private:
+    std::string m_mes;
+};
+
+class invalid_encoding : public std::exception
+{
+public:
+    /**
+     * @param offset position of the malformed sequence in bytes from the beginning of the text
+     * @param reason description of the sequence
+     */
+    invalid_encoding(size_t offset, const std::string& reason) noexcept
+        : m_offset(offset), m_reason(reason)
+    {
+        m_mes = "Invalid encoding at byte " + std::to_string(offset) + ": " + reason;
+    }
+
+    const char* what() const noexcept override
+    {
+        return m_mes.c_str();
+    }
+
+    size_t offset() const noexcept { return m_offset; }
+    const std::string& reason() const noexcept { return m_reason; }
+
+    //! Name of the malformed file, empty unless the error was found by a loader of several files
+    const std::string& getFileName() const { return m_filename; }
+
+    //! Attach name of the malformed file, the message is prefixed with it
+    void setFileName(const std::string& filename)
+    {
+        if(!m_filename.empty())
+            m_mes.erase(0, m_filename.size() + 2);
+        m_filename = filename;
+        m_mes.insert(0, m_filename + ": ");
+    }
+
+private:
+    size_t m_offset;
+    std::string m_reason;
+    std::string m_filename;
+    std::string m_mes;
+};
+
+/**
+ * Field of a schema which could not be bound
+ */
+struct field_error
+{
+    std::string section;
+    std::string name;
+    bool missing;       //!< true if required value is absent, false if it could not be converted
+    size_t line_no;     //!< line of the value, 0 if it is missing or was bound from a parsed file
+};
+
+class binding_error : public std::exception
+{
+public:
+    explicit binding_error(std::vector<field_error> errors) noexcept
+        : m_errors(std::move(errors))
+    {
+        m_mes = "Could not bind fields:";
+        for(const field_error& error: m_errors)
+            m_mes += " '" + error.section + "." + error.name + "' " + (error.missing ? "missing;" : "not convertible;");
+        m_mes.pop_back();
+    }
+
+    const char* what() const noexcept override
+    {
+        return m_mes.c_str();
+    }
+
+    const std::vector<field_error>& errors() const noexcept { return m_errors; }
+private:
+    std::vector<field_error> m_errors;
+    std::string m_mes;
+};
+
+class interpolation_error : public std::exception
+{
+public:
+    /**
+     * @param section, name value containing the reference
+     * @param reason description of the reference
+     */
+    interpolation_error(const std::string& section, const std::string& name, const std::string& reason) noexcept
+        : m_section(section), m_name(name)
+    {
+        m_mes = "Could not interpolate '" + section + "." + name + "': " + reason;
+    }
+
+    const char* what() const noexcept override
+    {
+        return m_mes.c_str();
+    }
+
+    const std::string& section() const noexcept { return m_section; }
+    const std::string& name() const noexcept { return m_name; }
+
+private:
+    std::string m_section;
+    std::string m_name;
+    std::string m_mes;
+};
+
 class parsing_error : public std::exception
 {
 public:
@@ -31,9 +175,22 @@ public:
     }
 
     size_t getLineNumber() const { return m_line_no; }
+
+    //! Name of the file containing the line, empty unless the error was found by a loader of several files
+    const std::string& getFileName() const { return m_filename; }
+
+    //! Attach name of the file containing the line, the message is prefixed with it
+    void setFileName(const std::string& filename)
+    {
+        if(!m_filename.empty())
+            m_mes.erase(0, m_filename.size() + 2);
+        m_filename = filename;
+        m_mes.insert(0, m_filename + ": ");
+    }
 protected:
     std::string m_mes;
     size_t m_line_no;
+    std::string m_filename;
 };
 
 class parsing_fail : public parsing_error
@@ -56,6 +213,16 @@ public:
     }
 };
 
+class include_error : public parsing_error
+{
+public:
+    explicit include_error(size_t line_no, const std::string& path) noexcept
+        : parsing_error(line_no)
+    {
+        m_mes += "could not include '" + path + "'";
+    }
+};
+
 class section_error : public parsing_error
 {
 public:
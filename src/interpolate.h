@@ -0,0 +1,305 @@
+#ifndef INI_INTERPOLATE_H
+#define INI_INTERPOLATE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "parser.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * Resolver of references in values of a file
+ * Values containing '$' are nodes of the dependency graph, their texts are split into pieces which are either
+ * literal text or a reference to another node. Referenced values without '$' are leaf nodes, environment variables
+ * become literal pieces. Nodes are resolved in depth-first post order, so every node is built once from the results
+ * of the nodes it refers to, and the file is changed only after all nodes are resolved.
+ * A reference is replaced with the string the referenced value converts to, with quotes escaped by backslashes,
+ * so that the string is kept as is by the conversion of the referring value, quoted or not.
+ */
+template <typename String, typename Storage>
+class interpolator
+{
+    using char_type = typename String::value_type;
+    using traits_type = typename String::traits_type;
+    using view_type = std::basic_string_view<char_type, traits_type>;
+    using text_type = std::basic_string<char_type, traits_type>;
+
+    static constexpr size_t npos = size_t(-1);
+
+    struct piece
+    {
+        view_type text;
+        size_t node = npos;     //!< index of referenced node, text is used if npos
+    };
+
+    enum class state
+    {
+        unvisited,
+        visiting,
+        resolved
+    };
+
+    struct node
+    {
+        Section<String, Storage>* section;
+        view_type section_name;
+        view_type name;
+        BasicValue<String>* value;
+        bool leaf;                  //!< value without references, it is not changed
+        std::vector<piece> pieces;
+        text_type result;
+        text_type substitution;     //!< escaped string of result, empty until the node is referred to
+        bool substituted = false;
+        state status = state::unvisited;
+    };
+
+public:
+    explicit interpolator(File<String, Storage>& file) : m_file(file) {}
+
+    /**
+     * @throw ini::interpolation_error if a reference is malformed, refers to nothing or is circular
+     */
+    void run()
+    {
+        for(auto& section: m_file)
+            for(auto& value: section.second.values())
+                if(value.second.view().find(char_type('$')) != view_type::npos)
+                    add_node(section.second, section.first, value.first, value.second, false);
+        // leaf nodes are appended while splitting
+        for(size_t i = 0, count = m_nodes.size(); i < count; ++i)
+            split(i);
+        for(size_t i = 0; i < m_nodes.size(); ++i)
+            visit(i);
+
+        for(node& n: m_nodes)
+        {
+            if(n.leaf)
+                continue;
+            Section<String, Storage>& section = *n.section;
+            section.m_content_hash -= Section<String, Storage>::entryHash(n.name, n.value->view());
+            *n.value = BasicValue<String>(make_string(tag_t<String>(), view_type(n.result), section.get_allocator()));
+            section.m_content_hash += Section<String, Storage>::entryHash(n.name, n.value->view());
+        }
+    }
+
+private:
+    size_t add_node(Section<String, Storage>& section, view_type section_name, view_type name,
+                    BasicValue<String>& value, bool leaf)
+    {
+        m_index.emplace(&value, m_nodes.size());
+        m_nodes.push_back(node{&section, section_name, name, &value, leaf, {}, {}, {}});
+        if(leaf)
+            m_nodes.back().pieces.push_back(piece{value.view()});
+        return m_nodes.size() - 1;
+    }
+
+    //! Split text of node i into pieces, "$${" gives literal "${"
+    void split(size_t i)
+    {
+        const view_type text = m_nodes[i].value->view();
+        std::vector<piece> pieces;
+        size_t literal = 0;
+        for(size_t pos = text.find(char_type('$')); pos != view_type::npos; pos = text.find(char_type('$'), pos))
+        {
+            if(text.compare(pos, 3, escape()) == 0)
+            {
+                pieces.push_back(piece{text.substr(literal, pos + 1 - literal)});
+                literal = pos += 2;
+                continue;
+            }
+            if(text.compare(pos, 2, escape().substr(1)) != 0)
+            {
+                ++pos;
+                continue;
+            }
+            const size_t close = text.find(char_type('}'), pos + 2);
+            if(close == view_type::npos)
+                fail(m_nodes[i], "unterminated reference '" + error_string(text.substr(pos)) + "'");
+            pieces.push_back(piece{text.substr(literal, pos - literal)});
+            pieces.push_back(reference(i, text.substr(pos + 2, close - pos - 2)));
+            literal = pos = close + 1;
+        }
+        pieces.push_back(piece{text.substr(literal)});
+        m_nodes[i].pieces = std::move(pieces);
+    }
+
+    //! Piece of reference 'section:name', 'name' of the same section or 'env:NAME'
+    piece reference(size_t i, view_type ref)
+    {
+        const node& n = m_nodes[i];
+        // value names could not contain ':', section names could
+        const size_t colon = ref.rfind(char_type(':'));
+        const view_type section_name = colon == view_type::npos ? n.section_name : ref.substr(0, colon);
+        const view_type name = colon == view_type::npos ? ref : ref.substr(colon + 1);
+        if(name.empty())
+            fail(n, "empty reference '${" + error_string(ref) + "}'");
+
+        if(colon != view_type::npos && section_name == env_section())
+        {
+            const char* value = std::getenv(error_string(name).c_str());
+            if(!value)
+                fail(n, "environment variable '" + error_string(name) + "' is not set");
+            if constexpr (sizeof(char_type) == 1)
+                m_env.push_back(escaped(value));
+            else
+                m_env.push_back(escaped(view_type(decode<char_type>(value, encoding::utf8))));
+            return piece{m_env.back()};
+        }
+
+        const auto section = m_file.find(section_name);
+        if(section == m_file.end())
+            fail(n, "reference to missing section '" + error_string(section_name) + "'");
+        const auto value = section->second.values().find(name);
+        if(value == section->second.values().end())
+            fail(n, "reference to missing value '" + error_string(section_name) + "." + error_string(name) + "'");
+        const auto it = m_index.find(&value->second);
+        if(it != m_index.end())
+            return piece{{}, it->second};
+        return piece{{}, add_node(section->second, section->first, value->first, value->second, true)};
+    }
+
+    //! Resolve node i after the nodes it refers to, iteratively, so long chains don't exhaust the stack
+    void visit(size_t i)
+    {
+        if(m_nodes[i].status != state::unvisited)
+            return;
+        std::vector<std::pair<size_t, size_t>> stack{{i, 0}};     // node and its next piece
+        m_nodes[i].status = state::visiting;
+        while(!stack.empty())
+        {
+            node& n = m_nodes[stack.back().first];
+            size_t& next = stack.back().second;
+            while(next < n.pieces.size() && n.pieces[next].node == npos)
+                ++next;
+            if(next == n.pieces.size())
+            {
+                resolve(n);
+                stack.pop_back();
+                continue;
+            }
+
+            const size_t dependency = n.pieces[next++].node;
+            if(m_nodes[dependency].status == state::visiting)
+                fail(m_nodes[dependency], "circular reference " + cycle(stack, dependency));
+            if(m_nodes[dependency].status == state::unvisited)
+            {
+                m_nodes[dependency].status = state::visiting;
+                stack.emplace_back(dependency, 0);
+            }
+        }
+    }
+
+    void resolve(node& n)
+    {
+        size_t size = 0;
+        for(const piece& p: n.pieces)
+            size += p.node == npos ? p.text.size() : substitution(p.node).size();
+        n.result.reserve(size);
+        for(const piece& p: n.pieces)
+            n.result += p.node == npos ? p.text : view_type(substitution(p.node));
+        n.status = state::resolved;
+    }
+
+    //! String of resolved node i to be put in place of references to it, computed once
+    const text_type& substitution(size_t i)
+    {
+        node& n = m_nodes[i];
+        if(!n.substituted)
+        {
+            n.substitution = escaped(from_string(tag_t<text_type>(), view_type(n.result)));
+            n.substituted = true;
+        }
+        return n.substitution;
+    }
+
+    //! Quotes are escaped, backslashes could not be, conversions to strings remove all of them
+    static text_type escaped(view_type str)
+    {
+        text_type res;
+        res.reserve(str.size() + std::count(str.begin(), str.end(), char_type('"')));
+        for(char_type c: str)
+        {
+            if(c == char_type('"'))
+                res += char_type('\\');
+            res += c;
+        }
+        return res;
+    }
+
+    //! Text of the cycle closed by the reference to dependency, e.g. "a.x -> b.y -> a.x"
+    std::string cycle(const std::vector<std::pair<size_t, size_t>>& stack, size_t dependency) const
+    {
+        std::string res;
+        size_t first = stack.size();
+        while(stack[first - 1].first != dependency)
+            --first;
+        for(size_t i = first - 1; i < stack.size(); ++i)
+            res += full_name(m_nodes[stack[i].first]) + " -> ";
+        return res + full_name(m_nodes[dependency]);
+    }
+
+    static std::string full_name(const node& n)
+    {
+        return error_string(n.section_name) + "." + error_string(n.name);
+    }
+
+    [[noreturn]] static void fail(const node& n, const std::string& reason)
+    {
+        throw interpolation_error(error_string(n.section_name), error_string(n.name), reason);
+    }
+
+    static view_type escape() noexcept
+    {
+        static constexpr char_type res[] = {char_type('$'), char_type('$'), char_type('{')};
+        return view_type(res, 3);
+    }
+
+    static view_type env_section() noexcept
+    {
+        static constexpr char_type res[] = {char_type('e'), char_type('n'), char_type('v')};
+        return view_type(res, 3);
+    }
+
+    File<String, Storage>& m_file;
+    std::vector<node> m_nodes;
+    std::unordered_map<const BasicValue<String>*, size_t> m_index;
+    std::deque<text_type> m_env;    //!< escaped values of environment variables referred to by pieces
+};
+
+}
+
+/**
+ * @brief Replace references in values of file with the values they refer to
+ * References are '${section:name}', '${name}' of the same section and '${env:NAME}' of environment variables,
+ * '$${' gives literal '${'. A reference is replaced with the string the referenced value converts to, i.e. without
+ * quotes and backslashes, with its quotes escaped by backslashes. So 'greet = "Hello ${name}!"' with 'name = "John"'
+ * becomes 'greet = "Hello John!"', and as<String>() of a value gives the strings of its references.
+ * Referenced values are interpolated first, every value is resolved once however many values refer to it,
+ * so the time is linear in the total size of values. Values are plain strings afterwards, their lookups
+ * and conversions cost nothing extra. The file is not changed if an error is thrown.
+ * @attention section 'env' could not be referred to, its name is reserved for the environment
+ * @throw ini::interpolation_error if a reference is malformed, refers to nothing or is circular
+ */
+template <typename String, typename Storage>
+void interpolate(File<String, Storage>& file)
+{
+    static_assert(!std::is_same<String, std::basic_string_view<typename String::value_type, typename String::traits_type>>::value,
+                  "interpolated values are new strings, file must own its strings");
+
+    details::interpolator<String, Storage>(file).run();
+}
+
+}
+
+#endif //INI_INTERPOLATE_H
@@ -0,0 +1,211 @@
+#ifndef INI_LAZYFILE_H
+#define INI_LAZYFILE_H
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "mapping.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * parse_events() handler building a single section
+ * Input must start with the section header line.
+ */
+template <typename String, typename Storage>
+class section_builder : public event_handler<typename String::value_type, typename String::traits_type>
+{
+public:
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    void section(size_t /*line_no*/, view_type name)
+    {
+        m_section = std::make_unique<Section<String, Storage>>(make_string(tag_t<String>(), name, string_allocator_t<String>()));
+    }
+
+    void value(size_t line_no, view_type name, view_type value)
+    {
+        m_section->addValue(line_no, name, value);
+    }
+
+    std::unique_ptr<Section<String, Storage>> release() noexcept { return std::move(m_section); }
+
+private:
+    std::unique_ptr<Section<String, Storage>> m_section;
+};
+
+/**
+ * @brief Find the first section header line at or after pos
+ * pos must be the beginning of a line. Only lines containing '[' are classified.
+ * @param first beginning of the whole text
+ * @return pointer to the beginning of the header line or last if there is none
+ */
+template <typename CharT, typename Traits>
+const CharT* find_section_header(const CharT* first, const CharT* pos, const CharT* last)
+{
+    using cc = syntax::details::char_class<CharT>;
+
+    while(const CharT* bracket = Traits::find(pos, last - pos, CharT('[')))
+    {
+        const CharT* line = bracket;
+        while(line != first && line[-1] != CharT('\n') && cc::is_space(line[-1]))
+            --line;
+        if(line == first || line[-1] == CharT('\n'))
+        {
+            const CharT* end = Traits::find(bracket, last - bracket, CharT('\n'));
+            if(syntax::lex_line(line, end ? end : last).type == syntax::line_type::section)
+                return line;
+        }
+        pos = bracket + 1;
+    }
+    return last;
+}
+
+}
+
+/**
+ * File which sections are parsed on first access
+ * Loading only locates section headers, checks that they are unique and that nothing but comments precedes
+ * the first of them. Errors inside a section are thrown by the first at() or find() of that section.
+ * Access is thread-safe, every section is parsed once.
+ * @tparam S string type, std::basic_string_view keeps views into the text owned by the file
+ * @tparam Storage storage policy of sections and of the section index
+ */
+template <typename S = std::string, typename Storage = ordered_storage>
+class LazyFile
+{
+public:
+    using string_type = S;
+    using char_type = typename S::value_type;
+    using traits_type = typename S::traits_type;
+    using view_type = std::basic_string_view<char_type, traits_type>;
+    using section_type = Section<S, Storage>;
+
+    LazyFile() = default;
+
+    /**
+     * @brief Map file and index its sections
+     * @throw std::system_error if file could not be mapped
+     * @throw ini::parsing_error if section headers or lines before the first one contain errors
+     */
+    explicit LazyFile(const std::string& filename)
+        : m_mapping(filename)
+    {
+        static_assert(std::is_same<char_type, char>::value, "files are mapped as narrow text");
+        index(view_type(m_mapping.data(), m_mapping.size()));
+    }
+
+    LazyFile(LazyFile&&) noexcept = default;
+    LazyFile& operator=(LazyFile&&) noexcept = default;
+
+    /**
+     * @brief Index sections of text kept by the file
+     * @throw ini::parsing_error if section headers or lines before the first one contain errors
+     */
+    static LazyFile from_text(std::basic_string<char_type, traits_type> text)
+    {
+        LazyFile res;
+        res.m_text = std::make_unique<const std::basic_string<char_type, traits_type>>(std::move(text));
+        res.index(*res.m_text);
+        return res;
+    }
+
+    /**
+     * @brief Get section, parse it if it is accessed for the first time
+     * @throw std::out_of_range if there is no such section
+     * @throw ini::parsing_error if section contains errors
+     */
+    const section_type& at(view_type name) const
+    {
+        if(const section_type* res = find(name))
+            return *res;
+        throw std::out_of_range("LazyFile::at");
+    }
+
+    /**
+     * @brief Get section, parse it if it is accessed for the first time
+     * @return nullptr if there is no such section
+     * @throw ini::parsing_error if section contains errors
+     */
+    const section_type* find(view_type name) const
+    {
+        auto it = m_index.find(name);
+        if(it == m_index.end())
+            return nullptr;
+        entry& e = *it->second;
+        std::call_once(e.parsed, [&e]
+        {
+            details::section_builder<S, Storage> builder;
+            parse_events(syntax::line_iterator<char_type, traits_type>(e.text.data(), e.text.data() + e.text.size()),
+                         syntax::line_iterator<char_type, traits_type>(), builder, e.line_no);
+            e.section = builder.release();
+        });
+        return e.section.get();
+    }
+
+    //! Number of sections
+    size_t size() const noexcept { return std::distance(m_index.begin(), m_index.end()); }
+
+private:
+    struct entry
+    {
+        view_type text;     //!< header line and all lines up to the next header
+        size_t line_no;     //!< line number of the header
+        std::once_flag parsed;
+        std::unique_ptr<section_type> section;
+    };
+
+    using index_type = details::map_derived_base_t<S, std::unique_ptr<entry>, Storage>;
+
+    void index(view_type text)
+    {
+        using iterator = syntax::line_iterator<char_type, traits_type>;
+
+        const char_type* first = text.data();
+        const char_type* last = first + text.size();
+        const char_type* header = details::find_section_header<char_type, traits_type>(first, first, last);
+
+        event_handler<char_type, traits_type> prefix_handler;
+        parse_events(iterator(first, header), iterator(), prefix_handler);
+
+        size_t line_no = 1 + std::count(first, header, char_type('\n'));
+        while(header != last)
+        {
+            const char_type* header_end = traits_type::find(header, last - header, char_type('\n'));
+            header_end = header_end ? header_end + 1 : last;
+            const char_type* next = details::find_section_header<char_type, traits_type>(first, header_end, last);
+
+            const view_type line(header, header_end - header);
+            const syntax::line_tokens tokens = syntax::lex_line(line.substr(0, line.find(char_type('\n'))));
+            const view_type name_view = line.substr(tokens.name.begin, tokens.name.size());
+            if(m_index.find(name_view) != m_index.end())
+                throw double_section_definition(line_no, details::error_string(name_view));
+            S name = details::make_string(tag_t<S>(), name_view, details::string_allocator_t<S>());
+
+            auto e = std::make_unique<entry>();
+            e->text = view_type(header, next - header);
+            e->line_no = line_no;
+            m_index.emplace(std::piecewise_construct, std::forward_as_tuple(std::move(name)),
+                            std::forward_as_tuple(std::move(e)));
+
+            line_no += std::count(header, next, char_type('\n'));
+            header = next;
+        }
+    }
+
+    details::mapped_file m_mapping;
+    std::unique_ptr<const std::basic_string<char_type, traits_type>> m_text;
+    index_type m_index;
+};
+
+}
+
+#endif //INI_LAZYFILE_H
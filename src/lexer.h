@@ -0,0 +1,347 @@
+#ifndef INI_LEXER_H
+#define INI_LEXER_H
+
+#include <cstddef>
+#include <iterator>
+#include <locale>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "scan.h"
+
+namespace ini
+{
+
+namespace syntax
+{
+
+/**
+ * Kind of a single ini line
+ */
+enum class line_type
+{
+    empty,      //!< zero length line
+    comment,    //!< line containing comment only
+    section,    //!< section header '[name]'
+    value,      //!< 'name = value ; comment'
+    invalid     //!< line not matching any rule
+};
+
+/**
+ * Half-open range of character positions inside a line
+ */
+struct token_range
+{
+    size_t begin = 0;
+    size_t end = 0;
+
+    bool empty() const noexcept { return begin == end; }
+    size_t size() const noexcept { return end - begin; }
+};
+
+/**
+ * Result of line classification
+ * All ranges are positions relative to the first character of the line
+ */
+struct line_tokens
+{
+    line_type type = line_type::invalid;
+    token_range name;       //!< section name or value name
+    token_range separator;  //!< one of ':', '=' or ':='
+    token_range value;      //!< value text
+    token_range comment;    //!< comment text including leading ';', empty if there is no comment
+};
+
+namespace details
+{
+
+/**
+ * Character classes used by ini grammar
+ * ASCII characters are classified inline, others are delegated to ctype facet of the global locale
+ * the same way std::regex_traits does it
+ */
+template <typename CharT>
+struct char_class
+{
+    using uchar_type = std::make_unsigned_t<CharT>;
+
+    static bool is_ascii(CharT c) noexcept { return static_cast<uchar_type>(c) < 0x80; }
+
+    static bool is_space(CharT c)
+    {
+        if(is_ascii(c))
+            return c == CharT(' ') || (c >= CharT('\t') && c <= CharT('\r'));
+        return std::use_facet<std::ctype<CharT>>(std::locale()).is(std::ctype_base::space, c);
+    }
+
+    static bool is_word(CharT c)
+    {
+        if(is_ascii(c))
+            return (c >= CharT('a') && c <= CharT('z')) || (c >= CharT('A') && c <= CharT('Z')) ||
+                   (c >= CharT('0') && c <= CharT('9')) || c == CharT('_');
+        return std::use_facet<std::ctype<CharT>>(std::locale()).is(std::ctype_base::alnum, c);
+    }
+
+    //! Characters not matched by ECMAScript '.'
+    static bool is_line_terminator(CharT c) noexcept
+    {
+        if(c == CharT('\n') || c == CharT('\r'))
+            return true;
+        return !std::is_same<CharT, char>::value &&
+               (static_cast<uchar_type>(c) == 0x2028 || static_cast<uchar_type>(c) == 0x2029);
+    }
+};
+
+template <typename CharT>
+const CharT* skip_spaces(const CharT* first, const CharT* last)
+{
+    while(first != last && char_class<CharT>::is_space(*first))
+        ++first;
+    return first;
+}
+
+template <typename CharT>
+const CharT* skip_word(const CharT* first, const CharT* last)
+{
+    while(first != last && char_class<CharT>::is_word(*first))
+        ++first;
+    return first;
+}
+
+template <typename CharT>
+bool has_line_terminator(const CharT* first, const CharT* last)
+{
+    for(; first != last; ++first)
+        if(char_class<CharT>::is_line_terminator(*first))
+            return true;
+    return false;
+}
+
+/**
+ * Match value and comment part of the line starting at pos
+ * @return false if there is no valid value
+ */
+template <typename CharT>
+bool lex_value_tail(const CharT* line, size_t pos, size_t size, line_tokens& tokens)
+{
+    using cc = char_class<CharT>;
+
+    const CharT* semicolon = std::char_traits<CharT>::find(line + pos, size - pos, CharT(';'));
+    const size_t comment = semicolon ? semicolon - line : size;
+    if(comment != size && has_line_terminator(line + comment + 1, line + size))
+        return false;
+
+    size_t first = pos;
+    while(first != comment && cc::is_space(line[first]))
+        ++first;
+    if(first == comment)
+        return false;
+    size_t last = comment;
+    while(cc::is_space(line[last - 1]))
+        --last;
+
+    // value consists of at least two characters, single character is prepended with one space before it
+    if(last - first == 1)
+    {
+        if(first == pos)
+            return false;
+        --first;
+    }
+
+    tokens.value = {first, last};
+    tokens.comment = {comment, size};
+    return true;
+}
+
+}
+
+/**
+ * @brief Classify and split a line in a single pass without allocation
+ * Grammar is equal to syntax::ini_traits regular expressions
+ * @param first pointer to the first character of the line
+ * @param last pointer past the last character of the line
+ * @return line type and positions of its parts
+ */
+template <typename CharT>
+line_tokens lex_line(const CharT* first, const CharT* last)
+{
+    using cc = details::char_class<CharT>;
+
+    line_tokens tokens;
+    const size_t size = last - first;
+    if(size == 0)
+    {
+        tokens.type = line_type::empty;
+        return tokens;
+    }
+
+    const CharT* it = details::skip_spaces(first, last);
+    if(it == last)
+        return tokens;
+
+    if(*it == CharT(';'))
+    {
+        if(!details::has_line_terminator(it + 1, last))
+        {
+            tokens.type = line_type::comment;
+            tokens.comment = {size_t(it - first), size};
+        }
+        return tokens;
+    }
+
+    if(*it == CharT('['))
+    {
+        const CharT* name_begin = details::skip_spaces(it + 1, last);
+        const CharT* name_end = details::skip_word(name_begin, last);
+        const CharT* close = details::skip_spaces(name_end, last);
+        if(name_begin != name_end && close != last && *close == CharT(']') && close + 1 == last)
+        {
+            tokens.type = line_type::section;
+            tokens.name = {size_t(name_begin - first), size_t(name_end - first)};
+        }
+        return tokens;
+    }
+
+    if(!cc::is_word(*it))
+        return tokens;
+
+    const CharT* name_end = details::skip_word(it, last);
+    const CharT* sep = details::skip_spaces(name_end, last);
+    if(sep == last || (*sep != CharT(':') && *sep != CharT('=')))
+        return tokens;
+    tokens.name = {size_t(it - first), size_t(name_end - first)};
+
+    size_t sep_pos = sep - first;
+    // ':=' is tried first, on failure '=' becomes the first character of the value
+    if(*sep == CharT(':') && sep + 1 != last && sep[1] == CharT('=') &&
+       details::lex_value_tail(first, sep_pos + 2, size, tokens))
+    {
+        tokens.type = line_type::value;
+        tokens.separator = {sep_pos, sep_pos + 2};
+        return tokens;
+    }
+    if(details::lex_value_tail(first, sep_pos + 1, size, tokens))
+    {
+        tokens.type = line_type::value;
+        tokens.separator = {sep_pos, sep_pos + 1};
+    }
+    return tokens;
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+line_tokens lex_line(const std::basic_string<CharT, Traits, Allocator>& line)
+{
+    return lex_line(line.data(), line.data() + line.size());
+}
+
+template <typename CharT, typename Traits>
+line_tokens lex_line(std::basic_string_view<CharT, Traits> line)
+{
+    return lex_line(line.data(), line.data() + line.size());
+}
+
+namespace details
+{
+
+//! Finder of line ends by Traits::find()
+template <typename CharT, typename Traits>
+class newline_finder
+{
+public:
+    newline_finder() noexcept = default;
+    newline_finder(const CharT* /*first*/, const CharT* /*last*/) noexcept {}
+
+    const CharT* find(const CharT* pos, const CharT* last) noexcept
+    {
+        const CharT* res = Traits::find(pos, last - pos, CharT('\n'));
+        return res ? res : last;
+    }
+};
+
+//! Narrow buffers are scanned by blocks, short lines are found in the masks of the current block
+template <>
+class newline_finder<char, std::char_traits<char>>
+{
+public:
+    newline_finder() noexcept = default;
+    newline_finder(const char* first, const char* last) noexcept : m_scanner(first, last) {}
+
+    const char* find(const char* pos, const char* /*last*/) noexcept
+    {
+        return m_scanner.find(pos);
+    }
+
+private:
+    newline_scanner m_scanner;
+};
+
+}
+
+/**
+ * Iterator over lines of a character buffer
+ * Splits buffer the same way std::getline does: at '\n' with no empty line after the last '\n'
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+class line_iterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::basic_string_view<CharT, Traits>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    //! Constructs end iterator
+    line_iterator() noexcept = default;
+
+    line_iterator(const CharT* first, const CharT* last) noexcept
+        : m_pos(first), m_last(last), m_finder(first, last)
+    {
+        find_end();
+    }
+
+    reference operator*() const noexcept { return m_line; }
+    pointer operator->() const noexcept { return &m_line; }
+
+    line_iterator& operator++() noexcept
+    {
+        m_pos += m_line.size();
+        if(m_pos != m_last)
+            ++m_pos;
+        find_end();
+        return *this;
+    }
+
+    line_iterator operator++(int) noexcept
+    {
+        line_iterator res = *this;
+        ++*this;
+        return res;
+    }
+
+    friend bool operator==(const line_iterator& l, const line_iterator& r) noexcept { return l.m_pos == r.m_pos; }
+    friend bool operator!=(const line_iterator& l, const line_iterator& r) noexcept { return l.m_pos != r.m_pos; }
+
+private:
+    void find_end() noexcept
+    {
+        if(m_pos == m_last)
+        {
+            m_pos = nullptr;
+            m_line = value_type();
+            return;
+        }
+        m_line = value_type(m_pos, m_finder.find(m_pos, m_last) - m_pos);
+    }
+
+    const CharT* m_pos = nullptr;
+    const CharT* m_last = nullptr;
+    details::newline_finder<CharT, Traits> m_finder;
+    value_type m_line;
+};
+
+}
+
+}
+
+#endif //INI_LEXER_H
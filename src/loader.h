@@ -0,0 +1,525 @@
+#ifndef INI_LOADER_H
+#define INI_LOADER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parser.h"
+#include "parallel.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+//! Match file name against pattern of '*' and '?' wildcards
+inline bool match_wildcard(std::string_view pattern, std::string_view name) noexcept
+{
+    size_t p = 0, n = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while(n < name.size())
+    {
+        if(p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if(p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            resume = n;
+        }
+        else if(star != std::string_view::npos)
+        {
+            p = star + 1;
+            n = ++resume;
+        }
+        else
+            return false;
+    }
+    while(p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+inline bool has_wildcards(const std::string& name) noexcept
+{
+    return name.find_first_of("*?") != std::string::npos;
+}
+
+/**
+ * @brief Files named by a path, a directory or a glob with wildcards in the last component
+ * Files of directories and globs are sorted by name, hidden files are skipped unless pattern starts with '.'.
+ * A path without wildcards which is not a directory is returned as is, even if it does not exist.
+ * @throw std::filesystem::filesystem_error if directory could not be read
+ */
+inline std::vector<std::filesystem::path> expand_path(const std::filesystem::path& path)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::path directory = path;
+    std::string pattern = "*";
+    if(!fs::is_directory(path, ec))
+    {
+        pattern = path.filename().string();
+        if(!has_wildcards(pattern))
+            return {path};
+        directory = path.parent_path();
+        if(!fs::is_directory(directory.empty() ? fs::path(".") : directory, ec))
+            return {};
+    }
+
+    std::vector<fs::path> res;
+    for(const fs::directory_entry& entry: fs::directory_iterator(directory.empty() ? fs::path(".") : directory))
+    {
+        const std::string name = entry.path().filename().string();
+        if((name[0] == '.' && pattern[0] != '.') || !match_wildcard(pattern, name) || !entry.is_regular_file(ec))
+            continue;
+        res.push_back(directory / name);
+    }
+    std::sort(res.begin(), res.end(), [](const fs::path& l, const fs::path& r)
+    {
+        return l.filename().native() < r.filename().native();
+    });
+    return res;
+}
+
+//! Identity of a file shared by all paths leading to it
+inline std::string source_key(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const std::filesystem::path res = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path.lexically_normal().string() : res.string();
+}
+
+/**
+ * @brief Path of include directive 'include path', empty if line is not one
+ * The path ends at the end of line or at a comment, spaces around it are skipped.
+ */
+template <typename CharT, typename Traits>
+std::basic_string_view<CharT, Traits> include_path(std::basic_string_view<CharT, Traits> line) noexcept
+{
+    using syntax::details::char_class;
+
+    constexpr CharT keyword[] = {CharT('i'), CharT('n'), CharT('c'), CharT('l'), CharT('u'), CharT('d'), CharT('e')};
+    constexpr size_t keyword_size = sizeof(keyword) / sizeof(CharT);
+
+    const CharT* first = syntax::details::skip_spaces(line.data(), line.data() + line.size());
+    const CharT* last = line.data() + line.size();
+    if(size_t(last - first) <= keyword_size || !std::equal(keyword, keyword + keyword_size, first) ||
+       !char_class<CharT>::is_space(first[keyword_size]))
+        return {};
+
+    first = syntax::details::skip_spaces(first + keyword_size, last);
+    if(const CharT* comment = Traits::find(first, last - first, CharT(';')))
+        last = comment;
+    while(last != first && char_class<CharT>::is_space(last[-1]))
+        --last;
+    return std::basic_string_view<CharT, Traits>(first, last - first);
+}
+
+struct include_directive
+{
+    size_t line_no;
+    std::filesystem::path path;     //!< as written, relative paths are relative to the including file
+};
+
+/**
+ * Parsed contents of one file, shared by files with equal contents
+ * Include directives split the file into parts, part i is followed by includes[i].
+ */
+template <typename String, typename Storage>
+struct parsed_source
+{
+    std::deque<File<String, Storage>> parts;
+    std::vector<include_directive> includes;
+    std::exception_ptr error;   //!< error which stopped parsing, parts contain the lines before it
+    size_t uses = 0;            //!< number of files with these contents, the last merged one moves the parts
+};
+
+/**
+ * parse_events() handler filling parts of parsed_source
+ * Every part is filled by its own file_builder. Sections continued after an include are reopened in the
+ * next part, duplicate sections and values are searched in all parts, so errors are the ones of parse().
+ */
+template <typename String, typename Storage>
+class source_builder : public event_handler<typename String::value_type, typename String::traits_type>
+{
+public:
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    source_builder(parsed_source<String, Storage>& source, const string_allocator_t<String>& alloc)
+        : m_source(source), m_alloc(alloc), m_section_name(make_string(tag_t<String>(), alloc))
+    {
+        next_part();
+    }
+
+    void section(size_t line_no, view_type name)
+    {
+        for(size_t i = 0; i + 1 < m_source.parts.size(); ++i)
+            if(m_source.parts[i].find(name) != m_source.parts[i].end())
+                throw double_section_definition(line_no, error_string(name));
+        m_builder->section(line_no, name);
+        m_section_name = make_string(tag_t<String>(), name, m_alloc);
+        m_reopen = false;
+    }
+
+    void value(size_t line_no, view_type name, view_type value)
+    {
+        if(m_reopen)
+        {
+            m_builder->section(line_no, m_section_name);
+            m_reopen = false;
+        }
+        for(size_t i = 0; i + 1 < m_source.parts.size(); ++i)
+        {
+            const File<String, Storage>& part = m_source.parts[i];
+            const auto section = part.find(m_section_name);
+            if(section != part.end() && section->second.find(name) != section->second.end())
+                throw double_value_definition(line_no, error_string(m_section_name), error_string(name));
+        }
+        m_builder->value(line_no, name, value);
+    }
+
+    void error(size_t line_no, error_code code, view_type line)
+    {
+        const view_type path = include_path(line);
+        if(path.empty())
+            throw_parsing_error(line_no, code, line);
+        m_source.includes.push_back({line_no, std::filesystem::path(std::basic_string<typename String::value_type>(path))});
+        next_part();
+        m_reopen = !m_section_name.empty();
+    }
+
+private:
+    void next_part()
+    {
+        m_source.parts.emplace_back(m_alloc);
+        m_builder.emplace(m_source.parts.back());
+    }
+
+    parsed_source<String, Storage>& m_source;
+    string_allocator_t<String> m_alloc;
+    std::optional<file_builder<String, Storage>> m_builder;
+    String m_section_name;      //!< current section, empty before the first one
+    bool m_reopen = false;      //!< current section belongs to a previous part
+};
+
+/**
+ * Loader of a tree of files
+ * Worker threads take files from a queue, parse them and queue the files they include. Every file is parsed
+ * once however many times it is included, and files with equal contents share one parse. When the queue is
+ * drained, files are merged on the calling thread in the order of the tree, so the result does not depend on
+ * which thread parsed what.
+ */
+template <typename String, typename Storage>
+class tree_loader
+{
+    using char_type = typename String::value_type;
+
+    struct resolved_include
+    {
+        std::vector<std::string> keys;
+        std::exception_ptr error;
+    };
+
+    struct source
+    {
+        std::filesystem::path path;
+        std::shared_ptr<parsed_source<String, Storage>> parsed;
+        std::vector<resolved_include> includes;
+        std::exception_ptr error;   //!< file could not be read or decoded
+        bool merged = false;
+    };
+
+    using parsed_future = std::shared_future<std::shared_ptr<parsed_source<String, Storage>>>;
+
+    //! Parse of contents, contents are kept to tell them from other contents with the same hash
+    struct cache_entry
+    {
+        std::shared_ptr<const std::string> bytes;
+        parsed_future parsed;
+    };
+
+public:
+    explicit tree_loader(File<String, Storage>& file) : m_file(file) {}
+
+    //! Queue file named by path, returns key of the file
+    std::string add(const std::filesystem::path& path)
+    {
+        std::string key = source_key(path);
+        const auto res = m_sources.try_emplace(key);
+        if(res.second)
+        {
+            res.first->second.path = path;
+            m_pending.push_back(&res.first->second);
+        }
+        return key;
+    }
+
+    void load(const std::vector<std::string>& roots, size_t threads_count)
+    {
+        if(threads_count == 0)
+            threads_count = std::max(1u, std::thread::hardware_concurrency());
+        for_each_chunk(threads_count, [this](size_t) { work(); });
+
+        m_file.clear();
+        for(const std::string& key: roots)
+            merge(m_sources.at(key));
+    }
+
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(true)
+        {
+            m_changed.wait(lock, [this] { return !m_pending.empty() || m_active == 0; });
+            if(m_pending.empty())
+                return;
+            source& src = *m_pending.front();
+            m_pending.pop_front();
+            ++m_active;
+            lock.unlock();
+
+            std::vector<std::pair<std::string, std::filesystem::path>> included = process(src);
+
+            lock.lock();
+            for(auto& path: included)
+            {
+                const auto res = m_sources.try_emplace(std::move(path.first));
+                if(!res.second)
+                    continue;
+                res.first->second.path = std::move(path.second);
+                m_pending.push_back(&res.first->second);
+            }
+            --m_active;
+            m_changed.notify_all();
+        }
+    }
+
+    //! Parse file and resolve its includes, returns keys and paths of the included files
+    std::vector<std::pair<std::string, std::filesystem::path>> process(source& src)
+    {
+        std::vector<std::pair<std::string, std::filesystem::path>> res;
+        try
+        {
+            std::error_code ec;
+            if(!std::filesystem::is_regular_file(src.path, ec))
+                throw std::system_error(ec ? ec : std::make_error_code(std::errc::invalid_argument),
+                                        "could not read '" + src.path.string() + "'");
+            errno = 0;
+            std::ifstream ifs(src.path, std::ios::binary);
+            if(!ifs)
+                throw std::system_error(errno ? std::error_code(errno, std::generic_category())
+                                              : std::make_error_code(std::errc::io_error),
+                                        "could not read '" + src.path.string() + "'");
+            const auto bytes = std::make_shared<const std::string>(read_bytes(ifs));
+            ifs.close();
+            const uint64_t hash = hash_string(std::string_view(*bytes));
+
+            parsed_future parsed;
+            std::promise<std::shared_ptr<parsed_source<String, Storage>>> promise;
+            bool owner = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                const auto range = m_cache.equal_range(hash);
+                const auto it = std::find_if(range.first, range.second, [&bytes](const auto& entry)
+                {
+                    return *entry.second.bytes == *bytes;
+                });
+                owner = it == range.second;
+                parsed = owner ? promise.get_future().share() : it->second.parsed;
+                if(owner)
+                    m_cache.emplace(hash, cache_entry{bytes, parsed});
+            }
+            if(owner)
+                promise.set_value(parse_source(*bytes));
+            src.parsed = parsed.get();
+
+            for(const include_directive& include: src.parsed->includes)
+                src.includes.push_back(resolve(src, include, res));
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++src.parsed->uses;
+        }
+        catch(...)
+        {
+            src.error = std::current_exception();
+        }
+        return res;
+    }
+
+    //! Parse text of bytes, the result keeps the error instead of throwing it
+    std::shared_ptr<parsed_source<String, Storage>> parse_source(const std::string& bytes) noexcept
+    {
+        auto res = std::make_shared<parsed_source<String, Storage>>();
+        try
+        {
+            details::parse_probe probe;
+            source_builder<String, Storage> builder(*res, m_file.get_allocator());
+            with_decoded<char_type>(bytes, [&builder](std::basic_string_view<char_type> text)
+            {
+                parse_events(syntax::line_iterator<char_type>(text.data(), text.data() + text.size()),
+                             syntax::line_iterator<char_type>(), builder);
+            });
+        }
+        catch(...)
+        {
+            res->error = std::current_exception();
+        }
+        return res;
+    }
+
+    resolved_include resolve(const source& src, const include_directive& include,
+                             std::vector<std::pair<std::string, std::filesystem::path>>& found) const
+    {
+        resolved_include res;
+        try
+        {
+            const std::filesystem::path path = include.path.is_relative() ? src.path.parent_path() / include.path
+                                                                          : include.path;
+            std::error_code ec;
+            if(!has_wildcards(path.filename().string()) && !std::filesystem::exists(path, ec))
+                throw include_error(include.line_no, include.path.string());
+            for(std::filesystem::path& file: expand_path(path))
+            {
+                res.keys.push_back(source_key(file));
+                found.emplace_back(res.keys.back(), std::move(file));
+            }
+        }
+        catch(parsing_error& e)
+        {
+            e.setFileName(src.path.string());
+            res.error = std::current_exception();
+        }
+        catch(...)
+        {
+            res.error = std::current_exception();
+        }
+        return res;
+    }
+
+    //! Merge file and the files it includes, every file is merged once at its first include
+    void merge(source& src)
+    {
+        if(src.merged)
+            return;
+        src.merged = true;
+        if(src.error)
+            std::rethrow_exception(src.error);
+
+        parsed_source<String, Storage>& parsed = *src.parsed;
+        const bool last_use = --parsed.uses == 0;
+        for(size_t i = 0; i < parsed.parts.size(); ++i)
+        {
+            for(auto& section: parsed.parts[i])
+            {
+                if(last_use)
+                    override_section(m_file, std::move(section.second));
+                else
+                    override_section(m_file, Section<String, Storage>(section.second));
+            }
+            if(i == parsed.includes.size())
+                break;
+            if(src.includes[i].error)
+                std::rethrow_exception(src.includes[i].error);
+            for(const std::string& key: src.includes[i].keys)
+                merge(m_sources.at(key));
+        }
+
+        if(parsed.error)
+        {
+            try
+            {
+                std::rethrow_exception(parsed.error);
+            }
+            catch(parsing_error& e)
+            {
+                e.setFileName(src.path.string());
+                throw;
+            }
+            catch(invalid_encoding& e)
+            {
+                e.setFileName(src.path.string());
+                throw;
+            }
+        }
+    }
+
+    File<String, Storage>& m_file;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::map<std::string, source> m_sources;    //!< nodes are stable, workers fill them without the lock
+    std::multimap<uint64_t, cache_entry> m_cache;    //!< by hash_string() of contents
+    std::deque<source*> m_pending;
+    size_t m_active = 0;
+};
+
+}
+
+/**
+ * @brief Load a tree of configuration files into one file using several threads
+ * Every path is a file, a directory, whose files are loaded in the order of names, or a glob with '*' and '?'
+ * in the file name, e.g. the *.conf files of a conf.d directory. Hidden files of directories and globs are skipped.
+ * Lines 'include path' load the files of path at that point, relative paths are relative to the including file
+ * and may be directories and globs as well. Included globs matching nothing are ignored.
+ *
+ * Files are merged in order: the files of paths one after another, the contents of every file interleaved
+ * with the files it includes at the lines of the includes. A value of a later file replaces the value with the
+ * same name in the same section of earlier ones, sections are merged. A file included several times, also
+ * recursively, is merged once at its first include; files with equal contents are parsed once.
+ * Within every file duplicate sections and values are errors as with parse().
+ * @param paths files, directories and globs
+ * @param file result, cleared before loading
+ * @param threads_count maximum number of threads, 0 means std::thread::hardware_concurrency()
+ * @throw ini::parsing_error with getFileName() of the file containing the error, the first one in merge order
+ * @throw ini::include_error if included path does not exist
+ * @throw ini::invalid_encoding with getFileName() of the malformed file
+ * @throw std::system_error if a file could not be read or a directory could not be listed
+ */
+template <typename String, typename Storage>
+void load_files(const std::vector<std::string>& paths, File<String, Storage>& file, size_t threads_count = 0)
+{
+    static_assert(!std::is_same<String, std::basic_string_view<typename String::value_type, typename String::traits_type>>::value,
+                  "file texts are not kept, file must own its strings");
+
+    details::tree_loader<String, Storage> loader(file);
+    std::vector<std::string> roots;
+    for(const std::string& path: paths)
+        for(const std::filesystem::path& source: details::expand_path(path))
+            roots.push_back(loader.add(source));
+    loader.load(roots, threads_count);
+}
+
+/**
+ * @brief Load a file, a directory or a glob with the files it includes, see load_files(const std::vector<std::string>&, File&, size_t)
+ */
+template <typename String, typename Storage>
+void load_files(const std::string& path, File<String, Storage>& file, size_t threads_count = 0)
+{
+    load_files(std::vector<std::string>{path}, file, threads_count);
+}
+
+}
+
+#endif //INI_LOADER_H
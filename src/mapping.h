@@ -0,0 +1,121 @@
+#ifndef INI_MAPPING_H
+#define INI_MAPPING_H
+
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * Read-only memory mapping of a whole file
+ * Mapped memory stays at the same address when the object is moved
+ */
+class mapped_file
+{
+public:
+    mapped_file() noexcept = default;
+
+    /**
+     * @brief Map file into memory
+     * @param filename path to the file
+     * @throw std::system_error if file could not be opened or mapped
+     */
+    explicit mapped_file(const std::string& filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::system_error(errno, std::generic_category(), "could not open '" + filename + "'");
+        try
+        {
+            map(fd, filename);
+        }
+        catch(...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    /**
+     * @brief Map whole file opened for reading, e.g. a shared memory object
+     * @param fd descriptor, stays open
+     * @param filename name for error messages
+     * @throw std::system_error if file could not be mapped
+     */
+    mapped_file(int fd, const std::string& filename)
+    {
+        map(fd, filename);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        if(this != &other)
+        {
+            unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    ~mapped_file() { unmap(); }
+
+    const char* data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    std::string_view view() const noexcept { return std::string_view(m_data, m_size); }
+
+private:
+    void map(int fd, const std::string& filename)
+    {
+        struct stat st{};
+        if(::fstat(fd, &st) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not stat '" + filename + "'");
+
+        m_size = static_cast<size_t>(st.st_size);
+        if(m_size != 0)
+        {
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data == MAP_FAILED)
+            {
+                m_size = 0;
+                throw std::system_error(errno, std::generic_category(), "could not map '" + filename + "'");
+            }
+            m_data = static_cast<const char*>(data);
+        }
+    }
+
+    void unmap() noexcept
+    {
+        if(m_data)
+            ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}
+
+}
+
+#endif //INI_MAPPING_H
@@ -0,0 +1,165 @@
+#ifndef INI_PARALLEL_H
+#define INI_PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "parser.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * @brief Find the beginning of the first section header line at or after pos
+ * pos must be the beginning of a line
+ * @return pointer to the header line or last if there is none
+ */
+template <typename CharT, typename Traits>
+const CharT* find_section_line(const CharT* pos, const CharT* last)
+{
+    for(syntax::line_iterator<CharT, Traits> it(pos, last), end; it != end; ++it)
+        if(syntax::lex_line(*it).type == syntax::line_type::section)
+            return it->data();
+    return last;
+}
+
+//! Beginning of the line following the one containing pos
+template <typename CharT, typename Traits>
+const CharT* next_line(const CharT* pos, const CharT* last)
+{
+    const CharT* res = Traits::find(pos, last - pos, CharT('\n'));
+    return res ? res + 1 : last;
+}
+
+/**
+ * @brief Split text into at most count chunks of roughly equal size
+ * Every chunk except the first one starts with a section header line
+ * @return pointers to the beginnings of the chunks followed by last
+ */
+template <typename CharT, typename Traits>
+std::vector<const CharT*> split_at_sections(const CharT* first, const CharT* last, size_t count)
+{
+    std::vector<const CharT*> res{first};
+    const size_t chunk_size = (last - first) / count;
+    for(size_t i = 1; i < count; ++i)
+    {
+        const CharT* pos = std::max(res.back() + 1, first + i * chunk_size);
+        if(pos >= last)
+            break;
+        pos = find_section_line<CharT, Traits>(next_line<CharT, Traits>(pos - 1, last), last);
+        if(pos == last)
+            break;
+        res.push_back(pos);
+    }
+    res.push_back(last);
+    return res;
+}
+
+//! Run f(i) for every chunk index on its own thread, the first chunk is handled by the calling thread
+template <typename F>
+void for_each_chunk(size_t count, F f)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for(size_t i = 1; i < count; ++i)
+        threads.emplace_back(f, i);
+    f(0);
+    for(std::thread& t: threads)
+        t.join();
+}
+
+}
+
+/**
+ * @brief Parse text using several threads
+ * Text is cut into chunks at section header lines, chunks are parsed concurrently into partial files and merged.
+ * Errors and their line numbers are the same as the ones of sequential parse().
+ * Values of File<std::string_view> refer to text, so it must outlive the file.
+ * @param text whole file contents
+ * @param file result, cleared before parsing
+ * @param threads_count maximum number of threads, 0 means std::thread::hardware_concurrency()
+ * @throw ini::parsing_error if text contains errors
+ */
+template <typename CharT, typename Traits, typename String, typename Storage>
+void parse_parallel(std::basic_string_view<CharT, Traits> text, File<String, Storage>& file, size_t threads_count = 0)
+{
+    static_assert(std::is_same<CharT, typename String::value_type>::value, "text and file must have the same character type");
+
+    using iterator = syntax::line_iterator<CharT, Traits>;
+
+    // chunks smaller than this are not worth a thread
+    constexpr size_t min_chunk_size = 64 * 1024;
+
+    if(threads_count == 0)
+        threads_count = std::max(1u, std::thread::hardware_concurrency());
+    threads_count = std::max<size_t>(1, std::min(threads_count, text.size() / min_chunk_size));
+
+    details::parse_probe probe;
+    const CharT* first = text.data();
+    const CharT* last = first + text.size();
+    file.clear();
+    if(threads_count == 1)
+    {
+        details::parse_lines(iterator(first, last), iterator(), file, 1, static_cast<details::section_lines<String>*>(nullptr));
+        return;
+    }
+
+    const std::vector<const CharT*> bounds = details::split_at_sections<CharT, Traits>(first, last, threads_count);
+    const size_t count = bounds.size() - 1;
+
+    std::vector<size_t> first_lines(count + 1, 1);
+    details::for_each_chunk(count, [&](size_t i)
+    {
+        first_lines[i + 1] = std::count(bounds[i], bounds[i + 1], CharT('\n'));
+    });
+    std::partial_sum(first_lines.begin(), first_lines.end(), first_lines.begin());
+
+    std::vector<File<String, Storage>> partials(count, file);
+    std::vector<details::section_lines<String>> sections(count);
+    std::vector<std::exception_ptr> errors(count);
+    // the first chunk is counted by the probe of the calling thread, the other ones are added after joining
+    parse_stats* const stats = details::parse_probe::current();
+    std::vector<parse_stats> chunk_stats(stats ? count : 0);
+    details::for_each_chunk(count, [&](size_t i)
+    {
+        const details::parse_probe::part part(stats && i ? &chunk_stats[i] : nullptr);
+        try
+        {
+            details::parse_lines(iterator(bounds[i], bounds[i + 1]), iterator(), partials[i], first_lines[i],
+                                 &sections[i]);
+        }
+        catch(...)
+        {
+            errors[i] = std::current_exception();
+        }
+    });
+    for(const parse_stats& s: chunk_stats)
+        *stats += s;
+
+    // chunks are merged in text order, so the first error found is the one sequential parsing would report
+    for(size_t i = 0; i < count; ++i)
+    {
+        for(const auto& section: sections[i])
+            details::merge_section(file, section.first, section.second, std::move(partials[i].at(section.first)));
+        if(errors[i])
+            std::rethrow_exception(errors[i]);
+    }
+}
+
+template <typename CharT, typename Traits, typename Allocator, typename Storage>
+void parse_parallel(const std::basic_string<CharT, Traits, Allocator>& text,
+                    File<std::basic_string<CharT, Traits, Allocator>, Storage>& file, size_t threads_count = 0)
+{
+    parse_parallel(std::basic_string_view<CharT, Traits>(text), file, threads_count);
+}
+
+}
+
+#endif //INI_PARALLEL_H
@@ -2,12 +2,20 @@
 #define INI_PARSER_H
 
 #include <map>
+#include <memory_resource>
+#include <new>
 #include <string>
-#include <regex>
+#include <string_view>
 #include <utility>
 #include <fstream>
+#include <iterator>
+#include <vector>
 #include "value.h"
 #include "errors.h"
+#include "encoding.h"
+#include "lexer.h"
+#include "sax.h"
+#include "storage.h"
 
 namespace ini
 {
@@ -15,23 +23,75 @@ namespace ini
 template <typename String>
 class Line;
 
-template <typename String>
+template <typename String, typename Storage = ordered_storage>
 class Section;
 
-template <typename String>
+template <typename String, typename Storage = ordered_storage>
 class File;
 
-template <typename Iter, typename String>
-void parse(Iter begin_iter, Iter end_iter, File<String>& file);
+template <typename Iter, typename String, typename Storage>
+void parse(Iter begin_iter, Iter end_iter, File<String, Storage>& file);
+
+template <typename String, typename Storage>
+void parse(const std::string& filename, File<String, Storage>& file);
+
+/**
+ * Pre-resolved key of a section or a value
+ * Keeps the name with its hash, so repeated lookups in hash_storage do not hash the name again.
+ * Lookups with other storages compare the name only. Name is not copied and must outlive the key,
+ * a key made of a literal could be constexpr.
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+class basic_key
+{
+public:
+    using view_type = std::basic_string_view<CharT, Traits>;
+
+    constexpr explicit basic_key(view_type name) noexcept
+        : m_name(name), m_hash(details::hash_string(name)) {}
+
+    constexpr view_type name() const noexcept { return m_name; }
+    constexpr uint64_t hash() const noexcept { return m_hash; }
+
+private:
+    view_type m_name;
+    uint64_t m_hash;
+};
+
+typedef basic_key<char> key;
+typedef basic_key<wchar_t> wkey;
+
+namespace details
+{
 
 template <typename String>
-void parse(const std::string& filename, File<String>& file);
+using section_lines = std::vector<std::pair<String, size_t>>;
+
+template <typename String, typename Storage>
+class file_builder;
+
+template <typename String, typename Storage>
+class section_builder;
+
+template <typename String, typename Storage>
+class diagnostic_builder;
+
+template <typename String, typename Storage>
+class interpolator;
+
+template <typename String, typename Storage>
+void merge_section(File<String, Storage>& file, const String& name, size_t line_no, Section<String, Storage>&& section);
+
+template <typename String, typename Storage>
+void override_section(File<String, Storage>& file, Section<String, Storage>&& section);
+
+}
 
 template <typename CharT, typename Traits, typename Allocator>
 class Line<std::basic_string<CharT, Traits, Allocator>> : public std::basic_string<CharT, Traits, Allocator>
 {
 public:
-    friend std::istream& operator>>(std::basic_istream<CharT, Traits>& is, Line& line)
+    friend std::basic_istream<CharT, Traits>& operator>>(std::basic_istream<CharT, Traits>& is, Line& line)
     {
         using std::getline;
         return getline(is, line);
@@ -41,139 +101,685 @@ public:
 namespace details
 {
 
-template <typename V>
-struct map_derived_helper
+template <typename S>
+struct string_allocator;
+
+template <typename CharT, typename Traits, typename Allocator>
+struct string_allocator<std::basic_string<CharT, Traits, Allocator>>
 {
-    using type = void;
+    using type = Allocator;
 };
 
-template <template <class> class V, typename CharT, typename Traits, typename Allocator>
-struct map_derived_helper<V<std::basic_string<CharT, Traits, Allocator> > >
+template <typename CharT, typename Traits>
+struct string_allocator<std::basic_string_view<CharT, Traits>>
 {
-    using string_type = std::basic_string<CharT, Traits, Allocator>;
-    using type = std::map<string_type, V<string_type>, std::less<string_type>, Allocator>;
+    using type = std::allocator<CharT>;
 };
 
-template <typename V>
-using map_derived_helper_t = typename map_derived_helper<V>::type;
+template <typename S>
+using string_allocator_t = typename string_allocator<S>::type;
+
+template <typename S, typename V, typename Storage>
+using map_derived_base_t = typename Storage::template container<S, V, string_allocator_t<S>>;
+
+//! Whether map has find(key, hash) taking precomputed hash_string() of the key
+template <typename Map, typename = void>
+struct has_hashed_find : std::false_type {};
+
+template <typename Map>
+struct has_hashed_find<Map, std::void_t<decltype(std::declval<Map&>().find(std::declval<typename Map::key_type>(),
+                                                                             uint64_t()))>> : std::true_type {};
 
-template <typename V>
-struct map_derived : private map_derived_helper_t<V>
+/**
+ * Map of any storage policy looked up by views and key handles, lookups never allocate
+ */
+template <typename S, typename V, typename Storage>
+struct map_derived : private map_derived_base_t<S, V, Storage>
 {
-    using string_type = typename map_derived_helper_t<V>::key_type;
-    using allocator_type = typename map_derived_helper_t<V>::allocator_type;
+    using string_type = S;
+    using view_type = std::basic_string_view<typename S::value_type, typename S::traits_type>;
+    using key_type = basic_key<typename S::value_type, typename S::traits_type>;
+    using allocator_type = string_allocator_t<S>;
+    using iterator = typename map_derived_base_t<S, V, Storage>::iterator;
+    using const_iterator = typename map_derived_base_t<S, V, Storage>::const_iterator;
+
+    explicit map_derived(const allocator_type& alloc = allocator_type()) : map_derived_base_t<S, V, Storage>(alloc) {}
+
+    map_derived(const map_derived&) = default;
+    map_derived(map_derived&&) = default;
+    map_derived& operator=(const map_derived&) = default;
+    map_derived& operator=(map_derived&&) = default;
+
+    map_derived(const map_derived& other, const allocator_type& alloc)
+        : map_derived_base_t<S, V, Storage>(other, alloc) {}
+
+    map_derived(map_derived&& other, const allocator_type& alloc)
+        : map_derived_base_t<S, V, Storage>(std::move(other), alloc) {}
+
+    allocator_type get_allocator() const { return allocator_type(base().get_allocator()); }
+
+    using map_derived_base_t<S, V, Storage>::begin;
+    using map_derived_base_t<S, V, Storage>::end;
+    using map_derived_base_t<S, V, Storage>::size;
+    using map_derived_base_t<S, V, Storage>::clear;
+
+    iterator find(view_type name) { return base().find(name); }
+    const_iterator find(view_type name) const { return base().find(name); }
+
+    iterator find(const key_type& key)
+    {
+        if constexpr(has_hashed_find<map_derived_base_t<S, V, Storage>>::value)
+            return base().find(key.name(), key.hash());
+        else
+            return base().find(key.name());
+    }
 
-    using map_derived_helper_t<V>::map_derived_helper_t;
-    using map_derived_helper_t<V>::at;
-    using map_derived_helper_t<V>::begin;
-    using map_derived_helper_t<V>::end;
-    using map_derived_helper_t<V>::find;
-    using map_derived_helper_t<V>::clear;
+    const_iterator find(const key_type& key) const
+    {
+        return const_cast<map_derived*>(this)->find(key);
+    }
+
+    /**
+     * @throw std::out_of_range if there is no such key
+     */
+    V& at(view_type name) { return checked(find(name)); }
+    const V& at(view_type name) const { return const_cast<map_derived*>(this)->at(name); }
+    V& at(const key_type& key) { return checked(find(key)); }
+    const V& at(const key_type& key) const { return const_cast<map_derived*>(this)->at(key); }
 
 protected:
-    using map_derived_helper_t<V>::get_allocator;
-    using map_derived_helper_t<V>::emplace;
+    using map_derived_base_t<S, V, Storage>::emplace;
+
+private:
+    map_derived_base_t<S, V, Storage>& base() noexcept { return *this; }
+    const map_derived_base_t<S, V, Storage>& base() const noexcept { return *this; }
+
+    V& checked(iterator it)
+    {
+        if(it == end())
+            throw std::out_of_range("map_derived::at");
+        return it->second;
+    }
 };
 
+template <typename CharT, typename Traits, typename Allocator>
+Allocator allocator_of(const std::basic_string<CharT, Traits, Allocator>& str)
+{
+    return str.get_allocator();
 }
 
-template <typename S>
-class Section : public details::map_derived<BasicValue<S>>
+template <typename CharT, typename Traits>
+std::allocator<CharT> allocator_of(std::basic_string_view<CharT, Traits>)
 {
+    return std::allocator<CharT>();
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+std::basic_string<CharT, Traits, Allocator> make_string(tag_t<std::basic_string<CharT, Traits, Allocator>>,
+                                                        const Allocator& alloc)
+{
+    return std::basic_string<CharT, Traits, Allocator>(alloc);
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+std::basic_string_view<CharT, Traits> make_string(tag_t<std::basic_string_view<CharT, Traits>>, const Allocator&)
+{
+    return std::basic_string_view<CharT, Traits>();
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+std::basic_string<CharT, Traits, Allocator> make_string(tag_t<std::basic_string<CharT, Traits, Allocator>>,
+                                                        std::basic_string_view<CharT, Traits> str,
+                                                        const Allocator& alloc)
+{
+    return std::basic_string<CharT, Traits, Allocator>(str, alloc);
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+std::basic_string_view<CharT, Traits> make_string(tag_t<std::basic_string_view<CharT, Traits>>,
+                                                  std::basic_string_view<CharT, Traits> str, const Allocator&)
+{
+    return str;
+}
+
+}
+
+/**
+ * Section of ini file
+ * @tparam S string type
+ * @tparam Storage storage policy: ordered_storage, flat_storage or hash_storage
+ */
+template <typename S, typename Storage>
+class Section : public details::map_derived<S, BasicValue<S>, Storage>
+{
+    using base_type = details::map_derived<S, BasicValue<S>, Storage>;
+
 public:
-    using string_type = typename details::map_derived<BasicValue<S>>::string_type;
-    using allocator_type = typename details::map_derived<BasicValue<S>>::allocator_type;
+    using string_type = typename details::map_derived<S, BasicValue<S>, Storage>::string_type;
+    using allocator_type = typename details::map_derived<S, BasicValue<S>, Storage>::allocator_type;
+
+    using view_type = typename details::map_derived<S, BasicValue<S>, Storage>::view_type;
+    using key_type = typename details::map_derived<S, BasicValue<S>, Storage>::key_type;
+    using iterator = typename details::map_derived<S, BasicValue<S>, Storage>::iterator;
 
     inline explicit Section(string_type section_name);
 
+    Section(const Section&) = default;
+    Section(Section&&) = default;
+    Section& operator=(const Section&) = default;
+    Section& operator=(Section&&) = default;
+
+    /**
+     * Uses-allocator constructors, containers with std::pmr and scoped allocators pass their allocator to sections
+     */
+    inline Section(view_type section_name, const allocator_type& alloc);
+    inline Section(const Section& other, const allocator_type& alloc);
+    inline Section(Section&& other, const allocator_type& alloc);
+
+    //! Converted value or default_value if there is no such value, the value is looked up once
+    template <typename T>
+    T get(view_type name, const T& default_value = T()) const;
+
     template <typename T>
-    T get(const string_type& name, const T& default_value = T()) const;
+    T get(const key_type& key, const T& default_value = T()) const;
+
+    /**
+     * Mutable access to values, the hash kept while parsing is not used by content_hash() afterwards
+     */
+    using base_type::begin;
+    using base_type::end;
+    using base_type::find;
+    using base_type::at;
+
+    iterator begin() { m_values_exposed = true; return base_type::begin(); }
+    iterator end() { m_values_exposed = true; return base_type::end(); }
+    iterator find(view_type name) { m_values_exposed = true; return base_type::find(name); }
+    iterator find(const key_type& key) { m_values_exposed = true; return base_type::find(key); }
+    BasicValue<S>& at(view_type name) { m_values_exposed = true; return base_type::at(name); }
+    BasicValue<S>& at(const key_type& key) { m_values_exposed = true; return base_type::at(key); }
+
+    /**
+     * @brief Hash of names and values
+     * Does not depend on the order of values, so equal sections have equal hashes with any storage.
+     * The hash is kept while parsing, it is computed from the values if they could have been assigned
+     * through mutable access since.
+     */
+    uint64_t content_hash() const noexcept
+    {
+        if(!m_values_exposed)
+            return m_content_hash;
+        uint64_t res = 0;
+        for(const auto& entry: *this)
+            res += entryHash(view_type(entry.first), entry.second.view());
+        return res;
+    }
+
+    template <typename String, typename StorageT>
+    friend class details::file_builder;
+
+    template <typename String, typename StorageT>
+    friend class details::section_builder;
+
+    template <typename String, typename StorageT>
+    friend class details::diagnostic_builder;
+
+    template <typename String, typename StorageT>
+    friend class details::interpolator;
 
-    template <typename Iter, typename String>
-    friend void parse(Iter begin_iter, Iter end_iter, File<String>& file);
+    template <typename String, typename StorageT>
+    friend void details::override_section(File<String, StorageT>& file, Section<String, StorageT>&& section);
 
 private:
-    inline void addFromString(size_t line_no, const string_type& str);
+    inline void addValue(size_t line_no, view_type name, view_type value);
+    //! Add value unless it is already defined, returns false for duplicate
+    inline bool tryAddValue(view_type name, view_type value);
+    //! Move values of other into the section replacing the values with the same names
+    inline void overrideValues(Section&& other);
 
-    const string_type m_section_name;
+    static uint64_t entryHash(view_type name, view_type value) noexcept
+    {
+        return details::mix_hash(details::hash_string(name) * 31 + details::hash_string(value));
+    }
+
+    //! Mutable access for friends which keep m_content_hash up to date themselves
+    base_type& values() noexcept { return *this; }
+
+    string_type m_section_name;
+    uint64_t m_content_hash = 0;
+    bool m_values_exposed = false;      //!< mutable access was given, m_content_hash could be outdated
 };
 
-template <typename S>
-class File : public details::map_derived<Section<S>>
+/**
+ * Parsed ini file
+ * Sections, values, map nodes and strings are allocated with the allocator of the file.
+ * With std::pmr::string and a buffer parsed through syntax::line_iterator the whole file
+ * could be built inside one std::pmr::monotonic_buffer_resource, see ini::pmr::File.
+ * @tparam S string type
+ * @tparam Storage storage policy: ordered_storage, flat_storage or hash_storage
+ */
+template <typename S, typename Storage>
+class File : public details::map_derived<S, Section<S, Storage>, Storage>
 {
 public:
-    using string_type = typename details::map_derived<Section<S>>::string_type;
-    using allocator_type = typename details::map_derived<Section<S>>::allocator_type;
+    using string_type = typename details::map_derived<S, Section<S, Storage>, Storage>::string_type;
+    using allocator_type = typename details::map_derived<S, Section<S, Storage>, Storage>::allocator_type;
+
+    explicit File(allocator_type alloc = allocator_type()) : details::map_derived<S, Section<S, Storage>, Storage>(alloc) {}
 
-    explicit File(allocator_type alloc = allocator_type()) : details::map_derived<Section<S>>(alloc) {}
+    template <typename String, typename StorageT>
+    friend class details::file_builder;
 
-    template <typename Iter, typename String>
-    friend void parse(Iter begin_iter, Iter end_iter, File<String>& file);
+    template <typename String, typename StorageT>
+    friend class details::diagnostic_builder;
+
+    template <typename String, typename StorageT>
+    friend void details::merge_section(File<String, StorageT>& file, const String& name, size_t line_no,
+                                       Section<String, StorageT>&& section);
+
+    template <typename String, typename StorageT>
+    friend void details::override_section(File<String, StorageT>& file, Section<String, StorageT>&& section);
 };
 
-template <typename S>
-Section<S>::Section(string_type section_name)
-        : details::map_derived<BasicValue<S>>(section_name.get_allocator()), m_section_name(std::move(section_name)) {}
+namespace pmr
+{
 
-template <typename S>
+/**
+ * File allocating from a std::pmr::memory_resource passed to its constructor
+ * Parsing from streams reads lines into buffers of the default resource, parse text buffers to avoid them.
+ */
+template <typename Storage = ordered_storage>
+using File = ini::File<std::pmr::string, Storage>;
+
+template <typename Storage = ordered_storage>
+using Section = ini::Section<std::pmr::string, Storage>;
+
+}
+
+template <typename S, typename Storage>
+Section<S, Storage>::Section(string_type section_name)
+        : details::map_derived<S, BasicValue<S>, Storage>(details::allocator_of(section_name)),
+          m_section_name(std::move(section_name)) {}
+
+template <typename S, typename Storage>
+Section<S, Storage>::Section(view_type section_name, const allocator_type& alloc)
+        : details::map_derived<S, BasicValue<S>, Storage>(alloc),
+          m_section_name(details::make_string(tag_t<string_type>(), section_name, alloc)) {}
+
+template <typename S, typename Storage>
+Section<S, Storage>::Section(const Section& other, const allocator_type& alloc)
+        : details::map_derived<S, BasicValue<S>, Storage>(other, alloc),
+          m_section_name(details::make_string(tag_t<string_type>(), view_type(other.m_section_name), alloc)),
+          m_content_hash(other.m_content_hash), m_values_exposed(other.m_values_exposed) {}
+
+template <typename S, typename Storage>
+Section<S, Storage>::Section(Section&& other, const allocator_type& alloc)
+        : details::map_derived<S, BasicValue<S>, Storage>(std::move(other), alloc),
+          m_section_name(details::make_string(tag_t<string_type>(), view_type(other.m_section_name), alloc)),
+          m_content_hash(other.m_content_hash), m_values_exposed(other.m_values_exposed) {}
+
+template <typename S, typename Storage>
 template <typename T>
-T Section<S>::get(const string_type& name, const T& default_value) const
+T Section<S, Storage>::get(view_type name, const T& default_value) const
 {
-    if(this->find(name) != this->end())
-        return this->at(name).template as<T>();
-    return default_value;
+    const auto it = this->find(name);
+    return it != this->end() ? it->second.template as<T>() : default_value;
 }
 
-template <typename S>
-void Section<S>::addFromString(size_t line_no, const string_type& str)
+template <typename S, typename Storage>
+template <typename T>
+T Section<S, Storage>::get(const key_type& key, const T& default_value) const
 {
-    std::match_results<typename string_type::const_iterator, allocator_type> match(this->get_allocator());
-    if(!std::regex_match(str, match, syntax::ini_traits<typename string_type::value_type>::value_regex()))
-        throw parsing_fail(line_no, str);
-
-    if(this->find(match[1].str()) != this->end())
-        throw double_value_definition(line_no, m_section_name, match[1].str());
+    const auto it = this->find(key);
+    return it != this->end() ? it->second.template as<T>() : default_value;
+}
 
-    this->emplace(std::piecewise_construct, std::forward_as_tuple(match[1].str()),
-                   std::forward_as_tuple(match[3].str()));
+template <typename S, typename Storage>
+void Section<S, Storage>::addValue(size_t line_no, view_type name, view_type value)
+{
+    if(!tryAddValue(name, value))
+        throw double_value_definition(line_no, details::error_string(m_section_name), details::error_string(name));
 }
 
-template <typename Iter, typename String>
-void parse(Iter begin_iter, Iter end_iter, File<String>& file)
+template <typename S, typename Storage>
+bool Section<S, Storage>::tryAddValue(view_type name, view_type value)
 {
-    using char_type = typename String::value_type;
-    using ini_traits = syntax::ini_traits<char_type>;
+    if(values().find(name) != values().end())
+        return false;
 
-    file.clear();
-    String current_section(file.get_allocator());
-    std::match_results<typename String::const_iterator, typename String::allocator_type> match(file.get_allocator());
-    size_t line_no = 1;
-    for(Iter it = begin_iter; it != end_iter; ++it, ++line_no)
+    const auto alloc = this->get_allocator();
+    string_type key = details::make_string(tag_t<string_type>(), name, alloc);
+
+    this->emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                  std::forward_as_tuple(details::make_string(tag_t<string_type>(), value, alloc)));
+    // sum of mixed entry hashes is independent of the order of entries
+    m_content_hash += entryHash(name, value);
+    return true;
+}
+
+template <typename S, typename Storage>
+void Section<S, Storage>::overrideValues(Section&& other)
+{
+    const auto alloc = this->get_allocator();
+    for(auto& entry: other.values())
     {
-        if(it->empty() || std::regex_match(*it, ini_traits::comment_line_regex()))
+        const view_type name = entry.first;
+        const auto it = values().find(name);
+        if(it != values().end())
+        {
+            m_content_hash -= entryHash(name, it->second.view());
+            it->second = std::move(entry.second);
             continue;
-        if(std::regex_match(*it, match, ini_traits::section_name_regex()))
+        }
+        this->emplace(std::piecewise_construct, std::forward_as_tuple(details::make_string(tag_t<string_type>(), name, alloc)),
+                      std::forward_as_tuple(std::move(entry.second)));
+    }
+    m_content_hash += other.m_content_hash;
+    m_values_exposed = m_values_exposed || other.m_values_exposed;
+}
+
+/**
+ * Errors found by parse() with std::nothrow
+ * Every diagnostic keeps only positions, message texts are formatted when requested.
+ */
+class parse_result
+{
+public:
+    //! Returns true if there were no errors
+    bool ok() const noexcept { return m_diagnostics.empty(); }
+    explicit operator bool() const noexcept { return ok(); }
+
+    //! Errors in order of lines
+    const std::vector<diagnostic>& diagnostics() const noexcept { return m_diagnostics; }
+
+    //! Same text as what() of the exception parse() throws for the error
+    std::string message(const diagnostic& d) const
+    {
+        const std::string text = m_texts.substr(d.text_begin, d.text_size);
+        switch(d.code)
         {
-            current_section = match[1].str();
-            if(file.find(current_section) != file.end())
-                throw double_section_definition(line_no, current_section);
-            file.emplace(std::piecewise_construct, std::forward_as_tuple(current_section),
-                                std::forward_as_tuple(current_section));
+        case error_code::out_of_section_declaration:
+            return out_of_section_declaration(d.line_no).what();
+        case error_code::double_section_definition:
+            return double_section_definition(d.line_no, text).what();
+        case error_code::double_value_definition:
+            return double_value_definition(d.line_no, text.substr(0, d.text_size - d.name_size),
+                                           text.substr(d.text_size - d.name_size)).what();
+        case error_code::invalid_encoding:
+            return ini::invalid_encoding(d.column, text).what();
+        case error_code::parsing_fail:
+            break;
         }
-        else
+        return parsing_fail(d.line_no, text).what();
+    }
+
+    template <typename String, typename Storage>
+    friend class details::diagnostic_builder;
+
+    template <typename String, typename Storage>
+    friend parse_result parse(const std::string& filename, File<String, Storage>& file, std::nothrow_t);
+
+private:
+    void add(size_t line_no, size_t column, error_code code, const std::string& text, size_t name_size = 0)
+    {
+        m_diagnostics.push_back(diagnostic{line_no, static_cast<uint32_t>(column), code,
+                                           static_cast<uint32_t>(m_texts.size()), static_cast<uint32_t>(text.size()),
+                                           static_cast<uint32_t>(name_size)});
+        m_texts += text;
+    }
+
+    std::vector<diagnostic> m_diagnostics;
+    std::string m_texts;    //!< texts of all diagnostics one after another
+};
+
+namespace details
+{
+
+/**
+ * parse_events() handler filling File
+ * Duplicate sections and values are reported by throwing exceptions, as well as all other errors.
+ */
+template <typename String, typename Storage>
+class file_builder : public event_handler<typename String::value_type, typename String::traits_type>
+{
+public:
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    /**
+     * @param file file to add sections to
+     * @param sections if not null, receives names and line numbers of parsed section headers
+     */
+    explicit file_builder(File<String, Storage>& file, section_lines<String>* sections = nullptr)
+        : m_file(file), m_sections(sections) {}
+
+    void section(size_t line_no, view_type name)
+    {
+        if(m_file.find(name) != m_file.end())
+            throw double_section_definition(line_no, error_string(name));
+        String section_name = make_string(tag_t<String>(), name, m_file.get_allocator());
+        m_section = &m_file.emplace(std::piecewise_construct, std::forward_as_tuple(section_name),
+                                    std::forward_as_tuple(section_name)).first->second;
+        if(m_sections)
+            m_sections->emplace_back(std::move(section_name), line_no);
+    }
+
+    void value(size_t line_no, view_type name, view_type value)
+    {
+        m_section->addValue(line_no, name, value);
+    }
+
+private:
+    File<String, Storage>& m_file;
+    section_lines<String>* m_sections;
+    Section<String, Storage>* m_section = nullptr;
+};
+
+/**
+ * parse_events() handler filling File and collecting errors instead of throwing them
+ * The first definition of a section or a value is kept, values of a duplicate section are skipped.
+ */
+template <typename String, typename Storage>
+class diagnostic_builder : public event_handler<typename String::value_type, typename String::traits_type>
+{
+public:
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    diagnostic_builder(File<String, Storage>& file, parse_result& result) noexcept
+        : m_file(file), m_result(result) {}
+
+    //! Set line which the next events refer to, names are located in it to compute columns
+    void line(view_type line) noexcept { m_line = line; }
+
+    void section(size_t line_no, view_type name)
+    {
+        if(m_file.find(name) != m_file.end())
         {
-            if(current_section.empty())
-                throw out_of_section_declaration(line_no);
-            file.at(current_section).addFromString(line_no, *it);
+            m_result.add(line_no, column(name), error_code::double_section_definition, error_string(name));
+            m_section = nullptr;
+            return;
         }
+        String section_name = make_string(tag_t<String>(), name, m_file.get_allocator());
+        m_section = &m_file.emplace(std::piecewise_construct, std::forward_as_tuple(section_name),
+                                    std::forward_as_tuple(section_name)).first->second;
+    }
+
+    void value(size_t line_no, view_type name, view_type value)
+    {
+        if(m_section && !m_section->tryAddValue(name, value))
+            m_result.add(line_no, column(name), error_code::double_value_definition,
+                         error_string(m_section->m_section_name) + error_string(name), name.size());
+    }
+
+    void error(size_t line_no, error_code code, view_type line)
+    {
+        const auto* first = line.data();
+        m_result.add(line_no, syntax::details::skip_spaces(first, first + line.size()) - first + 1, code,
+                     error_string(line));
     }
+
+private:
+    size_t column(view_type token) const noexcept { return token.data() - m_line.data() + 1; }
+
+    File<String, Storage>& m_file;
+    parse_result& m_result;
+    view_type m_line;
+    Section<String, Storage>* m_section = nullptr;
+};
+
+/**
+ * @brief Parse lines into file without clearing it
+ * @param line_no number of the first line
+ * @param sections if not null, receives names and line numbers of parsed section headers
+ */
+template <typename Iter, typename String, typename Storage>
+void parse_lines(Iter begin_iter, Iter end_iter, File<String, Storage>& file, size_t line_no,
+                 section_lines<String>* sections)
+{
+    file_builder<String, Storage> builder(file, sections);
+    parse_events(begin_iter, end_iter, builder, line_no);
 }
 
-template <typename String>
-void parse(const std::string& filename, File<String>& file)
+/**
+ * @brief Move section parsed separately into file
+ * @param line_no line of the section header
+ */
+template <typename String, typename Storage>
+void merge_section(File<String, Storage>& file, const String& name, size_t line_no, Section<String, Storage>&& section)
+{
+    if(file.find(name) != file.end())
+        throw double_section_definition(line_no, error_string(name));
+    file.emplace(std::piecewise_construct, std::forward_as_tuple(name), std::forward_as_tuple(std::move(section)));
+}
+
+/**
+ * @brief Move section into file, values of section replace the ones of the section with the same name in file
+ */
+template <typename String, typename Storage>
+void override_section(File<String, Storage>& file, Section<String, Storage>&& section)
+{
+    const auto it = file.find(section.m_section_name);
+    if(it != file.end())
+        it->second.overrideValues(std::move(section));
+    else
+        file.emplace(std::piecewise_construct, std::forward_as_tuple(section.m_section_name),
+                     std::forward_as_tuple(std::move(section)));
+}
+
+}
+
+/**
+ * Incremental parser filling File from chunks of text, see push_parser
+ * Errors are reported by the same exceptions as parse() throws.
+ * @tparam String owning string type, views could not outlive the chunks
+ */
+template <typename String, typename Storage = ordered_storage>
+class file_push_parser
+{
+    static_assert(!std::is_same<String, std::basic_string_view<typename String::value_type, typename String::traits_type>>::value,
+                  "chunks are not kept, file must own its strings");
+public:
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    //! Clear file and prepare to fill it, file must outlive the parser
+    explicit file_push_parser(File<String, Storage>& file)
+        : m_builder((file.clear(), file)), m_parser(m_builder) {}
+
+    file_push_parser(const file_push_parser&) = delete;
+    file_push_parser& operator=(const file_push_parser&) = delete;
+
+    void feed(view_type chunk) { m_parser.feed(chunk); }
+    void finish() { m_parser.finish(); }
+
+private:
+    details::file_builder<String, Storage> m_builder;
+    push_parser<details::file_builder<String, Storage>, typename String::value_type, typename String::traits_type> m_parser;
+};
+
+template <typename Iter, typename String, typename Storage>
+void parse(Iter begin_iter, Iter end_iter, File<String, Storage>& file)
+{
+    details::parse_probe probe;
+    file.clear();
+    details::parse_lines(begin_iter, end_iter, file, 1, static_cast<details::section_lines<String>*>(nullptr));
+}
+
+/**
+ * @brief Parse file in UTF-8, UTF-16LE or UTF-16BE, see detect_encoding()
+ * Text is transcoded into the encoding of the file strings, UTF-8 is parsed into narrow strings as is.
+ * A file which could not be read gives an empty file.
+ * @throw ini::invalid_encoding if text is malformed
+ */
+template <typename String, typename Storage>
+void parse(const std::string& filename, File<String, Storage>& file)
+{
+    using char_type = typename String::value_type;
+    static_assert(!std::is_same<String, std::basic_string_view<char_type, typename String::traits_type>>::value,
+                  "file text is not kept, file must own its strings");
+
+    details::parse_probe probe;
+    const std::string bytes = details::read_bytes(filename);
+    details::with_decoded<char_type>(bytes, [&file](std::basic_string_view<char_type> text)
+    {
+        parse(syntax::line_iterator<char_type>(text.data(), text.data() + text.size()), syntax::line_iterator<char_type>(), file);
+    });
+}
+
+/**
+ * @brief Parse lines reporting all errors at once instead of throwing the first of them
+ * Lines with errors are skipped, the first definition of a duplicate section or value is kept,
+ * so file contains everything that could be parsed. Malformed input never causes exceptions.
+ * @return errors of all lines
+ */
+template <typename Iter, typename String, typename Storage>
+parse_result parse(Iter begin_iter, Iter end_iter, File<String, Storage>& file, std::nothrow_t)
+{
+    using view_type = std::basic_string_view<typename String::value_type, typename String::traits_type>;
+
+    details::parse_probe probe;
+    file.clear();
+    parse_result res;
+    details::diagnostic_builder<String, Storage> builder(file, res);
+    event_parser<details::diagnostic_builder<String, Storage>, typename String::value_type,
+                 typename String::traits_type> parser(builder);
+    parse_stats* const stats = details::parse_probe::current();
+    for(Iter it = begin_iter; it != end_iter;)
+    {
+        const view_type line = *it;
+        builder.line(line);
+        parser.parse_line(line);
+        details::phase_timer timer(stats, &parse_stats::read_time);
+        ++it;
+    }
+    return res;
+}
+
+/**
+ * @brief Parse file reporting all errors at once, see parse(const std::string&, File&)
+ * Malformed text is reported as error_code::invalid_encoding with the byte offset in the column, file is left empty.
+ */
+template <typename String, typename Storage>
+parse_result parse(const std::string& filename, File<String, Storage>& file, std::nothrow_t)
 {
-    std::ifstream ifs(filename);
-    parse(std::istream_iterator<Line<String>>(ifs), std::istream_iterator<Line<String>>(), file);
+    using char_type = typename String::value_type;
+    static_assert(!std::is_same<String, std::basic_string_view<char_type, typename String::traits_type>>::value,
+                  "file text is not kept, file must own its strings");
+
+    details::parse_probe probe;
+    const std::string bytes = details::read_bytes(filename);
+    try
+    {
+        return details::with_decoded<char_type>(bytes, [&file](std::basic_string_view<char_type> text)
+        {
+            return parse(syntax::line_iterator<char_type>(text.data(), text.data() + text.size()),
+                         syntax::line_iterator<char_type>(), file, std::nothrow);
+        });
+    }
+    catch(const invalid_encoding& e)
+    {
+        file.clear();
+        parse_result res;
+        res.add(0, e.offset(), error_code::invalid_encoding, e.reason());
+        return res;
+    }
 }
 
 }
@@ -0,0 +1,471 @@
+#ifndef INI_PERSISTENT_H
+#define INI_PERSISTENT_H
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "parser.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * Immutable balanced search tree, modifications return a new tree
+ * Nodes are shared between versions, an insertion or removal copies only the nodes on the path to the key.
+ * Entries live in their own shared allocations, so copied nodes don't copy keys and values.
+ * @tparam S string type of keys
+ * @tparam V mapped type
+ */
+template <typename S, typename V>
+class persistent_map
+{
+public:
+    using key_type = S;
+    using mapped_type = V;
+    using value_type = std::pair<const S, V>;
+    using view_type = std::basic_string_view<typename S::value_type, typename S::traits_type>;
+    using entry_ptr = std::shared_ptr<const value_type>;
+
+private:
+    struct node;
+    using node_ptr = std::shared_ptr<const node>;
+
+    struct node
+    {
+        entry_ptr entry;
+        node_ptr left;
+        node_ptr right;
+        size_t size;
+        int height;
+    };
+
+public:
+    /**
+     * In-order iterator, keeps the path from the root
+     * Valid while any version containing the iterated nodes lives
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename persistent_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+
+        const_iterator() = default;
+
+        reference operator*() const noexcept { return *m_path.back()->entry; }
+        pointer operator->() const noexcept { return m_path.back()->entry.get(); }
+
+        const_iterator& operator++()
+        {
+            const node* n = m_path.back();
+            if(n->right)
+            {
+                push_left(n->right.get());
+                return *this;
+            }
+            m_path.pop_back();
+            while(!m_path.empty() && m_path.back()->right.get() == n)
+            {
+                n = m_path.back();
+                m_path.pop_back();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator res = *this;
+            ++*this;
+            return res;
+        }
+
+        friend bool operator==(const const_iterator& l, const const_iterator& r) noexcept
+        {
+            return l.m_path.empty() ? r.m_path.empty() : !r.m_path.empty() && l.m_path.back() == r.m_path.back();
+        }
+        friend bool operator!=(const const_iterator& l, const const_iterator& r) noexcept { return !(l == r); }
+
+    private:
+        friend class persistent_map;
+
+        void push_left(const node* n)
+        {
+            for(; n; n = n->left.get())
+                m_path.push_back(n);
+        }
+
+        std::vector<const node*> m_path;
+    };
+
+    persistent_map() noexcept = default;
+
+    /**
+     * @brief Build tree from entries in one pass
+     * @param entries entries sorted by key without duplicates
+     */
+    explicit persistent_map(const std::vector<entry_ptr>& entries)
+        : m_root(build(entries.data(), entries.data() + entries.size())) {}
+
+    const_iterator begin() const
+    {
+        const_iterator res;
+        res.push_left(m_root.get());
+        return res;
+    }
+
+    const_iterator end() const noexcept { return const_iterator(); }
+
+    size_t size() const noexcept { return size_of(m_root); }
+    bool empty() const noexcept { return !m_root; }
+
+    const_iterator find(view_type key) const
+    {
+        const_iterator res;
+        for(const node* n = m_root.get(); n;)
+        {
+            res.m_path.push_back(n);
+            const int cmp = key.compare(view_type(n->entry->first));
+            if(cmp == 0)
+                return res;
+            if(cmp < 0)
+            {
+                n = n->left.get();
+                continue;
+            }
+            // the path keeps only nodes which are still to be visited
+            res.m_path.pop_back();
+            n = n->right.get();
+        }
+        return end();
+    }
+
+    //! Pointer to the mapped value or nullptr, cheaper than find()
+    const mapped_type* lookup(view_type key) const noexcept
+    {
+        for(const node* n = m_root.get(); n;)
+        {
+            const int cmp = key.compare(view_type(n->entry->first));
+            if(cmp == 0)
+                return &n->entry->second;
+            n = cmp < 0 ? n->left.get() : n->right.get();
+        }
+        return nullptr;
+    }
+
+    //! Tree with entry inserted or replacing the one with the same key
+    persistent_map insert_or_assign(entry_ptr entry) const
+    {
+        return persistent_map(insert(m_root, std::move(entry)));
+    }
+
+    //! Tree without key, shares the root if there is no such key
+    persistent_map erase(view_type key) const
+    {
+        return persistent_map(remove(m_root, key));
+    }
+
+    //! True if both trees are the same version, so their contents are equal without comparison
+    bool shares_with(const persistent_map& other) const noexcept { return m_root == other.m_root; }
+
+private:
+    explicit persistent_map(node_ptr root) noexcept : m_root(std::move(root)) {}
+
+    static size_t size_of(const node_ptr& n) noexcept { return n ? n->size : 0; }
+    static int height_of(const node_ptr& n) noexcept { return n ? n->height : 0; }
+
+    static node_ptr make_node(entry_ptr entry, node_ptr left, node_ptr right)
+    {
+        const size_t size = size_of(left) + size_of(right) + 1;
+        const int height = std::max(height_of(left), height_of(right)) + 1;
+        return std::make_shared<const node>(node{std::move(entry), std::move(left), std::move(right), size, height});
+    }
+
+    //! Node with subtrees which heights differ by at most 2, rotated to restore balance
+    static node_ptr balance(entry_ptr entry, node_ptr left, node_ptr right)
+    {
+        const int hl = height_of(left);
+        const int hr = height_of(right);
+        if(hl > hr + 1)
+        {
+            if(height_of(left->left) >= height_of(left->right))
+                return make_node(left->entry, left->left, make_node(std::move(entry), left->right, std::move(right)));
+            const node& lr = *left->right;
+            return make_node(lr.entry, make_node(left->entry, left->left, lr.left),
+                             make_node(std::move(entry), lr.right, std::move(right)));
+        }
+        if(hr > hl + 1)
+        {
+            if(height_of(right->right) >= height_of(right->left))
+                return make_node(right->entry, make_node(std::move(entry), std::move(left), right->left), right->right);
+            const node& rl = *right->left;
+            return make_node(rl.entry, make_node(std::move(entry), std::move(left), rl.left),
+                             make_node(right->entry, rl.right, right->right));
+        }
+        return make_node(std::move(entry), std::move(left), std::move(right));
+    }
+
+    static node_ptr build(const entry_ptr* first, const entry_ptr* last)
+    {
+        if(first == last)
+            return nullptr;
+        const entry_ptr* middle = first + (last - first) / 2;
+        return make_node(*middle, build(first, middle), build(middle + 1, last));
+    }
+
+    static node_ptr insert(const node_ptr& n, entry_ptr entry)
+    {
+        if(!n)
+            return make_node(std::move(entry), nullptr, nullptr);
+        const int cmp = view_type(entry->first).compare(view_type(n->entry->first));
+        if(cmp == 0)
+            return make_node(std::move(entry), n->left, n->right);
+        if(cmp < 0)
+            return balance(n->entry, insert(n->left, std::move(entry)), n->right);
+        return balance(n->entry, n->left, insert(n->right, std::move(entry)));
+    }
+
+    static node_ptr remove_min(const node_ptr& n)
+    {
+        if(!n->left)
+            return n->right;
+        return balance(n->entry, remove_min(n->left), n->right);
+    }
+
+    static node_ptr remove(const node_ptr& n, view_type key)
+    {
+        if(!n)
+            return n;
+        const int cmp = key.compare(view_type(n->entry->first));
+        if(cmp < 0)
+        {
+            node_ptr left = remove(n->left, key);
+            return left == n->left ? n : balance(n->entry, std::move(left), n->right);
+        }
+        if(cmp > 0)
+        {
+            node_ptr right = remove(n->right, key);
+            return right == n->right ? n : balance(n->entry, n->left, std::move(right));
+        }
+        if(!n->left)
+            return n->right;
+        if(!n->right)
+            return n->left;
+        const node* min = n->right.get();
+        while(min->left)
+            min = min->left.get();
+        return balance(min->entry, n->left, remove_min(n->right));
+    }
+
+    node_ptr m_root;
+};
+
+//! Sorted entries of map with keys and values converted by make_entry
+template <typename Entry, typename Map, typename MakeEntry>
+std::vector<Entry> sorted_entries(const Map& map, MakeEntry make_entry)
+{
+    std::vector<Entry> res;
+    for(const auto& item: map)
+        res.push_back(make_entry(item));
+    std::sort(res.begin(), res.end(), [](const Entry& l, const Entry& r) { return l->first < r->first; });
+    return res;
+}
+
+}
+
+/**
+ * Immutable section sharing its values with other versions
+ * Copies are O(1), set() and erase() return a new version which shares all values but the changed one.
+ * Values keep their conversion caches between versions.
+ * @tparam S string type, views must outlive all versions
+ */
+template <typename S = std::string>
+class PersistentSection
+{
+    using map_type = details::persistent_map<S, BasicValue<S>>;
+public:
+    using string_type = S;
+    using view_type = typename map_type::view_type;
+    using value_type = typename map_type::value_type;
+    using const_iterator = typename map_type::const_iterator;
+    using iterator = const_iterator;
+
+    PersistentSection() noexcept = default;
+
+    //! Copy values of section
+    template <typename Storage>
+    explicit PersistentSection(const Section<S, Storage>& section)
+        : m_values(details::sorted_entries<typename map_type::entry_ptr>(section, [](const auto& value)
+          {
+              return std::make_shared<const value_type>(value.first, value.second);
+          })) {}
+
+    const_iterator begin() const { return m_values.begin(); }
+    const_iterator end() const noexcept { return m_values.end(); }
+    size_t size() const noexcept { return m_values.size(); }
+    bool empty() const noexcept { return m_values.empty(); }
+
+    const_iterator find(view_type name) const { return m_values.find(name); }
+
+    /**
+     * @brief Get value
+     * @throw std::out_of_range if there is no such value
+     */
+    const BasicValue<S>& at(view_type name) const
+    {
+        if(const BasicValue<S>* res = m_values.lookup(name))
+            return *res;
+        throw std::out_of_range("PersistentSection::at");
+    }
+
+    template <typename T>
+    T get(view_type name, const T& default_value = T()) const
+    {
+        const BasicValue<S>* res = m_values.lookup(name);
+        return res ? res->template as<T>() : default_value;
+    }
+
+    //! Version with value added or replaced
+    PersistentSection set(string_type name, string_type value) const
+    {
+        return PersistentSection(m_values.insert_or_assign(std::make_shared<const value_type>(
+                std::piecewise_construct, std::forward_as_tuple(std::move(name)), std::forward_as_tuple(std::move(value)))));
+    }
+
+    //! Version without value, shares everything with this one if there is no such value
+    PersistentSection erase(view_type name) const { return PersistentSection(m_values.erase(name)); }
+
+    //! True if both objects are the same version, their values are equal then
+    bool shares_with(const PersistentSection& other) const noexcept { return m_values.shares_with(other.m_values); }
+
+    //! Compare names and values
+    friend bool operator==(const PersistentSection& l, const PersistentSection& r)
+    {
+        return l.shares_with(r) || (l.size() == r.size() && std::equal(l.begin(), l.end(), r.begin(),
+               [](const value_type& lv, const value_type& rv)
+               {
+                   return lv.first == rv.first && lv.second.view() == rv.second.view();
+               }));
+    }
+
+    friend bool operator!=(const PersistentSection& l, const PersistentSection& r) { return !(l == r); }
+
+private:
+    explicit PersistentSection(map_type values) noexcept : m_values(std::move(values)) {}
+
+    map_type m_values;
+};
+
+/**
+ * Immutable file sharing its sections with other versions
+ * Copies are O(1), changing one value copies only the paths to the section and to the value.
+ * Keeping many versions costs memory proportional to the changes between them.
+ * @tparam S string type, views must outlive all versions
+ */
+template <typename S = std::string>
+class PersistentFile
+{
+    using map_type = details::persistent_map<S, PersistentSection<S>>;
+public:
+    using string_type = S;
+    using view_type = typename map_type::view_type;
+    using value_type = typename map_type::value_type;
+    using section_type = PersistentSection<S>;
+    using const_iterator = typename map_type::const_iterator;
+    using iterator = const_iterator;
+
+    PersistentFile() noexcept = default;
+
+    //! Copy sections of file
+    template <typename Storage>
+    explicit PersistentFile(const File<S, Storage>& file)
+        : m_sections(details::sorted_entries<typename map_type::entry_ptr>(file, [](const auto& section)
+          {
+              return std::make_shared<const value_type>(section.first, section_type(section.second));
+          })) {}
+
+    /**
+     * @brief Copy sections of file reusing the ones equal in previous version
+     * Meant for reloads: unchanged sections are shared with previous, so versions kept together
+     * cost only their differences.
+     */
+    template <typename Storage>
+    PersistentFile(const File<S, Storage>& file, const PersistentFile& previous)
+        : m_sections(details::sorted_entries<typename map_type::entry_ptr>(file, [&previous](const auto& section)
+          {
+              section_type copy(section.second);
+              const auto it = previous.m_sections.find(view_type(section.first));
+              if(it != previous.end() && it->second == copy)
+                  return std::make_shared<const value_type>(section.first, it->second);
+              return std::make_shared<const value_type>(section.first, std::move(copy));
+          })) {}
+
+    const_iterator begin() const { return m_sections.begin(); }
+    const_iterator end() const noexcept { return m_sections.end(); }
+    size_t size() const noexcept { return m_sections.size(); }
+    bool empty() const noexcept { return m_sections.empty(); }
+
+    const_iterator find(view_type name) const { return m_sections.find(name); }
+
+    /**
+     * @brief Get section
+     * @throw std::out_of_range if there is no such section
+     */
+    const section_type& at(view_type name) const
+    {
+        if(const section_type* res = m_sections.lookup(name))
+            return *res;
+        throw std::out_of_range("PersistentFile::at");
+    }
+
+    //! Version with section added or replaced
+    PersistentFile set(string_type name, section_type section) const
+    {
+        return PersistentFile(m_sections.insert_or_assign(std::make_shared<const value_type>(
+                std::piecewise_construct, std::forward_as_tuple(std::move(name)), std::forward_as_tuple(std::move(section)))));
+    }
+
+    //! Version with value added or replaced, the section is created if it does not exist
+    PersistentFile set(string_type section_name, string_type name, string_type value) const
+    {
+        const section_type* section = m_sections.lookup(section_name);
+        section_type changed = (section ? *section : section_type()).set(std::move(name), std::move(value));
+        return set(std::move(section_name), std::move(changed));
+    }
+
+    //! Version without section
+    PersistentFile erase(view_type name) const { return PersistentFile(m_sections.erase(name)); }
+
+    //! Version without value, shares everything with this one if there is no such value
+    PersistentFile erase(view_type section_name, view_type name) const
+    {
+        const auto it = m_sections.find(section_name);
+        if(it == end())
+            return *this;
+        section_type changed = it->second.erase(name);
+        if(changed.shares_with(it->second))
+            return *this;
+        return set(it->first, std::move(changed));
+    }
+
+    //! True if both objects are the same version, their sections are equal then
+    bool shares_with(const PersistentFile& other) const noexcept { return m_sections.shares_with(other.m_sections); }
+
+private:
+    explicit PersistentFile(map_type sections) noexcept : m_sections(std::move(sections)) {}
+
+    map_type m_sections;
+};
+
+}
+
+#endif //INI_PERSISTENT_H
@@ -0,0 +1,331 @@
+#ifndef INI_RELOADER_H
+#define INI_RELOADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "parser.h"
+#include "cache.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * Registry of active readers for read-copy-update publication
+ * Readers enter and leave with one atomic operation each and never wait.
+ * Readers are counted in one of two groups, so a writer waiting for old readers is not delayed by new ones.
+ */
+class reader_registry
+{
+public:
+    //! Register reader, the returned ticket must be passed to leave()
+    size_t enter() noexcept
+    {
+        const size_t group = m_group.load(std::memory_order_seq_cst);
+        const size_t shard = thread_index() % shards_count;
+        m_counters[group][shard].value.fetch_add(1, std::memory_order_seq_cst);
+        return group * shards_count + shard;
+    }
+
+    void leave(size_t ticket) noexcept
+    {
+        m_counters[ticket / shards_count][ticket % shards_count].value.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Wait until all readers entered before the call have left
+     * Must not be called concurrently with itself
+     */
+    void synchronize() noexcept
+    {
+        // a reader may read the group just before it is switched, so both groups are drained
+        for(int i = 0; i < 2; ++i)
+        {
+            const size_t group = m_group.fetch_xor(1, std::memory_order_seq_cst);
+            while(count(group) != 0)
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr size_t shards_count = 16;
+
+    struct alignas(64) shard
+    {
+        std::atomic<int64_t> value{0};
+    };
+
+    int64_t count(size_t group) const noexcept
+    {
+        int64_t res = 0;
+        for(const shard& s: m_counters[group])
+            res += s.value.load(std::memory_order_seq_cst);
+        return res;
+    }
+
+    std::atomic<size_t> m_group{0};
+    shard m_counters[2][shards_count];
+};
+
+}
+
+/**
+ * Owner of a file which is reloaded in background when it changes on disk
+ * New versions are parsed off the reading path and published atomically, readers always see a complete
+ * version and never wait. A version is destroyed after the last reader which could see it is gone.
+ * If a new version contains errors, the previous one stays published.
+ * The watcher reloads the file when it is replaced by rename or closed after writing. While the file is written in
+ * place it is not reloaded, and a version parsed while a write started is dropped, the reload after that write
+ * publishes the file. A writer which keeps the file open and modifies it without closing it, e.g. a log-style
+ * append, therefore never triggers an automatic reload, call reload() after such writes.
+ * A reload() call has no such protection, it could publish a file truncated by a writer, so files which are
+ * reloaded manually should be replaced atomically, e.g. written to a temporary file and renamed.
+ * @tparam String owning string type
+ */
+template <typename String = std::string, typename Storage = ordered_storage>
+class Reloader
+{
+    static_assert(!std::is_same<String, std::basic_string_view<typename String::value_type, typename String::traits_type>>::value,
+                  "reloaded file must own its strings");
+
+    struct version_node
+    {
+        File<String, Storage> file;
+        uint64_t version = 0;
+    };
+
+public:
+    using file_type = File<String, Storage>;
+
+    /**
+     * Access to the version published when the guard was created
+     * Guard must not outlive the reloader and should be short-lived, it delays reclamation of old versions.
+     */
+    class read_guard
+    {
+    public:
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        read_guard(read_guard&& other) noexcept
+            : m_readers(std::exchange(other.m_readers, nullptr)), m_ticket(other.m_ticket), m_node(other.m_node) {}
+
+        ~read_guard()
+        {
+            if(m_readers)
+                m_readers->leave(m_ticket);
+        }
+
+        const file_type& operator*() const noexcept { return m_node->file; }
+        const file_type* operator->() const noexcept { return &m_node->file; }
+
+        //! Number of the version, the initial one is 1
+        uint64_t version() const noexcept { return m_node->version; }
+
+    private:
+        friend class Reloader;
+
+        explicit read_guard(details::reader_registry& readers, const std::atomic<const version_node*>& current) noexcept
+            : m_readers(&readers), m_ticket(readers.enter()), m_node(current.load(std::memory_order_seq_cst)) {}
+
+        details::reader_registry* m_readers;
+        size_t m_ticket;
+        const version_node* m_node;
+    };
+
+    /**
+     * @brief Parse file and start watching it
+     * @param filename path to the file
+     * @param watch reload automatically on changes, otherwise only by reload()
+     * @throw ini::parsing_error if file contains errors
+     * @throw std::system_error if watching could not be started
+     */
+    explicit Reloader(std::string filename, bool watch = true)
+        : m_filename(std::move(filename))
+    {
+        auto node = std::make_unique<version_node>();
+        parse(m_filename, node->file);
+        node->version = 1;
+        m_current.store(node.release(), std::memory_order_seq_cst);
+        if(!watch)
+            return;
+        try
+        {
+            start_watching();
+        }
+        catch(...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    Reloader(const Reloader&) = delete;
+    Reloader& operator=(const Reloader&) = delete;
+
+    ~Reloader() { release(); }
+
+    //! Get current version, never blocks
+    read_guard read() const noexcept
+    {
+        return read_guard(m_readers, m_current);
+    }
+
+    /**
+     * @brief Parse file and publish it if it contains no errors
+     * @return false if parsing failed, the error is available by last_error()
+     */
+    bool reload()
+    {
+        return load([] { return true; });
+    }
+
+    //! Error of the last reload, nullptr if it succeeded
+    std::exception_ptr last_error() const
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        return m_error;
+    }
+
+    //! Number of the published version
+    uint64_t version() const noexcept { return read().version(); }
+
+private:
+    /**
+     * @brief Parse file and publish it if it contains no errors
+     * @param unchanged called after parsing, neither the version nor its error is kept if it returns false
+     */
+    template <typename F>
+    bool load(F unchanged)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        auto node = std::make_unique<version_node>();
+        std::exception_ptr error;
+        try
+        {
+            parse(m_filename, node->file);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        if(!unchanged())
+            return false;
+        m_error = error;
+        if(error)
+            return false;
+        node->version = m_current.load(std::memory_order_relaxed)->version + 1;
+
+        const version_node* old = m_current.exchange(node.release(), std::memory_order_seq_cst);
+        m_readers.synchronize();
+        delete old;
+        return true;
+    }
+
+    void release() noexcept
+    {
+        if(m_watcher.joinable())
+        {
+            const uint64_t one = 1;
+            (void)::write(m_stop_fd, &one, sizeof(one));
+            m_watcher.join();
+        }
+        if(m_inotify_fd >= 0)
+            ::close(m_inotify_fd);
+        if(m_stop_fd >= 0)
+            ::close(m_stop_fd);
+        delete m_current.load(std::memory_order_acquire);
+    }
+
+    void start_watching()
+    {
+        const std::filesystem::path path = std::filesystem::absolute(m_filename);
+        m_inotify_fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if(m_inotify_fd < 0)
+            throw std::system_error(errno, std::generic_category(), "could not initialize inotify");
+        // editors and deployment tools often replace the file, so its directory is watched
+        if(::inotify_add_watch(m_inotify_fd, path.parent_path().c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+            throw std::system_error(errno, std::generic_category(), "could not watch '" + m_filename + "'");
+        m_stop_fd = ::eventfd(0, EFD_CLOEXEC);
+        if(m_stop_fd < 0)
+            throw std::system_error(errno, std::generic_category(), "could not create eventfd");
+        m_watcher = std::thread(&Reloader::watch, this, path.filename().string());
+    }
+
+    void watch(const std::string& name)
+    {
+        pollfd fds[2] = {{m_inotify_fd, POLLIN, 0}, {m_stop_fd, POLLIN, 0}};
+        bool changed = false;   // file was written or replaced since it was parsed
+        bool writing = false;   // file was modified in place and not closed yet
+        while(true)
+        {
+            if(::poll(fds, 2, -1) < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                return;
+            }
+            if(fds[1].revents)
+                return;
+
+            // several writes are reloaded once, after the last of them is closed
+            read_events(name, changed, writing);
+            // a write started during parsing could have been read partly, the file is parsed again after it
+            while(changed && !writing)
+            {
+                changed = false;
+                load([&]
+                {
+                    read_events(name, changed, writing);
+                    return !changed;
+                });
+            }
+        }
+    }
+
+    //! Drain pending events of the watched directory
+    void read_events(const std::string& name, bool& changed, bool& writing)
+    {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t size;
+        while((size = ::read(m_inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for(char* it = buffer; it < buffer + size;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(it);
+                if(event->len != 0 && name == event->name)
+                {
+                    changed = true;
+                    writing = (event->mask & IN_MODIFY) != 0;
+                }
+                it += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+
+    std::string m_filename;
+    std::atomic<const version_node*> m_current{nullptr};
+    mutable details::reader_registry m_readers;
+    mutable std::mutex m_write_mutex;
+    std::exception_ptr m_error;
+    int m_inotify_fd = -1;
+    int m_stop_fd = -1;
+    std::thread m_watcher;
+};
+
+}
+
+#endif //INI_RELOADER_H
@@ -0,0 +1,290 @@
+#ifndef INI_SAX_H
+#define INI_SAX_H
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "errors.h"
+#include "lexer.h"
+#include "stats.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+//! Narrow string for error messages, non ASCII wide characters are replaced with '?'
+template <typename String>
+std::string error_string(const String& str)
+{
+    using char_type = typename String::value_type;
+    if constexpr (sizeof(char_type) == 1)
+        return std::string(str.begin(), str.end());
+
+    std::string res;
+    res.reserve(str.size());
+    for(char_type c: str)
+        res.push_back(static_cast<std::make_unsigned_t<char_type>>(c) < 0x80 ? static_cast<char>(c) : '?');
+    return res;
+}
+
+}
+
+/**
+ * @brief Throw exception corresponding to the error reported by parse_events()
+ * @param line text of the line
+ */
+template <typename CharT, typename Traits>
+[[noreturn]] void throw_parsing_error(size_t line_no, error_code code, std::basic_string_view<CharT, Traits> line)
+{
+    if(code == error_code::out_of_section_declaration)
+        throw out_of_section_declaration(line_no);
+    throw parsing_fail(line_no, details::error_string(line));
+}
+
+/**
+ * Base of parse_events() handlers with empty callbacks
+ * Derived handler hides the callbacks it is interested in, no virtual calls are involved.
+ * Views passed to callbacks are valid only until the callback returns.
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+struct event_handler
+{
+    using view_type = std::basic_string_view<CharT, Traits>;
+
+    //! Section header '[name]'
+    void section(size_t /*line_no*/, view_type /*name*/) {}
+    //! Value 'name = value', value text is the same as the one stored in BasicValue
+    void value(size_t /*line_no*/, view_type /*name*/, view_type /*value*/) {}
+    //! Comment including leading ';', either on its own line or after a value
+    void comment(size_t /*line_no*/, view_type /*text*/) {}
+    //! Line which could not be parsed, parsing continues with the next line if the callback returns
+    void error(size_t line_no, error_code code, view_type line) { throw_parsing_error(line_no, code, line); }
+};
+
+/**
+ * Line by line parser reporting contents of lines to handler
+ * Keeps only the state needed between lines, so memory usage does not depend on the number of lines.
+ * Lines other than empty, comment or section lines before the first section are reported as
+ * error_code::out_of_section_declaration, lines not matching the grammar as error_code::parsing_fail.
+ * Duplicate sections and values are not detected.
+ * @tparam Handler object with section(), value(), comment() and error() callbacks, see event_handler
+ */
+template <typename Handler, typename CharT, typename Traits = std::char_traits<CharT>>
+class event_parser
+{
+public:
+    using view_type = std::basic_string_view<CharT, Traits>;
+
+    /**
+     * @param handler receiver of events, must outlive the parser
+     * @param line_no number of the first line
+     */
+    explicit event_parser(Handler& handler, size_t line_no = 1) noexcept
+        : m_handler(handler), m_line_no(line_no) {}
+
+    //! Parse one line without line terminator
+    void parse_line(view_type line)
+    {
+        const size_t line_no = m_line_no++;
+        parse_stats* const stats = details::parse_probe::current();
+        syntax::line_tokens tokens;
+        {
+            details::phase_timer timer(stats, &parse_stats::lex_time);
+            tokens = syntax::lex_line(line);
+        }
+        if(stats)
+            count(*stats, line, tokens);
+
+        details::phase_timer timer(stats, &parse_stats::insert_time);
+        switch(tokens.type)
+        {
+        case syntax::line_type::empty:
+            break;
+        case syntax::line_type::comment:
+            m_handler.comment(line_no, line.substr(tokens.comment.begin, tokens.comment.size()));
+            break;
+        case syntax::line_type::section:
+            m_in_section = true;
+            m_handler.section(line_no, line.substr(tokens.name.begin, tokens.name.size()));
+            break;
+        case syntax::line_type::value:
+            if(!m_in_section)
+            {
+                m_handler.error(line_no, error_code::out_of_section_declaration, line);
+                break;
+            }
+            m_handler.value(line_no, line.substr(tokens.name.begin, tokens.name.size()),
+                            line.substr(tokens.value.begin, tokens.value.size()));
+            if(!tokens.comment.empty())
+                m_handler.comment(line_no, line.substr(tokens.comment.begin, tokens.comment.size()));
+            break;
+        case syntax::line_type::invalid:
+            m_handler.error(line_no, m_in_section ? error_code::parsing_fail : error_code::out_of_section_declaration,
+                            line);
+            break;
+        }
+    }
+
+    //! Number of the next line
+    size_t line_number() const noexcept { return m_line_no; }
+
+private:
+    void count(parse_stats& stats, view_type line, const syntax::line_tokens& tokens) const noexcept
+    {
+        ++stats.lines;
+        stats.bytes += line.size() + 1;
+        switch(tokens.type)
+        {
+        case syntax::line_type::empty:
+            break;
+        case syntax::line_type::comment:
+            ++stats.comments;
+            break;
+        case syntax::line_type::section:
+            ++stats.sections;
+            break;
+        case syntax::line_type::value:
+            if(!m_in_section)
+            {
+                ++stats.errors;
+                break;
+            }
+            ++stats.values;
+            stats.comments += !tokens.comment.empty();
+            break;
+        case syntax::line_type::invalid:
+            ++stats.errors;
+            break;
+        }
+    }
+
+    Handler& m_handler;
+    size_t m_line_no;
+    bool m_in_section = false;
+};
+
+/**
+ * Resumable parser accepting input in chunks of arbitrary size
+ * Complete lines are reported as soon as their terminating '\n' arrives, lines taken whole from one chunk
+ * are not copied. Only the incomplete last line is buffered, so many parsers can run side by side.
+ * @tparam Handler object with section(), value(), comment() and error() callbacks, see event_handler
+ */
+template <typename Handler, typename CharT, typename Traits = std::char_traits<CharT>>
+class push_parser
+{
+public:
+    using view_type = std::basic_string_view<CharT, Traits>;
+
+    /**
+     * @param handler receiver of events, must outlive the parser
+     * @param line_no number of the first line
+     */
+    explicit push_parser(Handler& handler, size_t line_no = 1) noexcept
+        : m_parser(handler, line_no) {}
+
+    /**
+     * @brief Parse all lines completed by chunk
+     * Exceptions thrown by handler are propagated, the line they were thrown for is consumed.
+     */
+    void feed(view_type chunk)
+    {
+        while(!chunk.empty())
+        {
+            const size_t end = chunk.find(CharT('\n'));
+            if(end == view_type::npos)
+            {
+                m_line.append(chunk.data(), chunk.size());
+                return;
+            }
+            const view_type line = chunk.substr(0, end);
+            chunk.remove_prefix(end + 1);
+            if(m_line.empty())
+            {
+                m_parser.parse_line(line);
+                continue;
+            }
+            m_line.append(line.data(), line.size());
+            std::basic_string<CharT, Traits> complete;
+            complete.swap(m_line);
+            m_parser.parse_line(complete);
+            // keep allocated buffer for the next split line
+            complete.clear();
+            m_line.swap(complete);
+        }
+    }
+
+    //! Parse the last line if it is not terminated with '\n'
+    void finish()
+    {
+        if(m_line.empty())
+            return;
+        std::basic_string<CharT, Traits> last;
+        last.swap(m_line);
+        m_parser.parse_line(last);
+    }
+
+    //! Number of the next line to be completed
+    size_t line_number() const noexcept { return m_parser.line_number(); }
+
+private:
+    event_parser<Handler, CharT, Traits> m_parser;
+    std::basic_string<CharT, Traits> m_line;    //!< beginning of incomplete line
+};
+
+/**
+ * @brief Parse lines and report their contents to handler without building a File
+ * @param begin_iter, end_iter range of lines, dereferenced iterator must be convertible to a string view
+ * @param handler object with section(), value(), comment() and error() callbacks, see event_handler
+ * @param line_no number of the first line
+ */
+template <typename Iter, typename Handler>
+void parse_events(Iter begin_iter, Iter end_iter, Handler& handler, size_t line_no = 1)
+{
+    using line_type = std::decay_t<decltype(*begin_iter)>;
+
+    event_parser<Handler, typename line_type::value_type, typename line_type::traits_type> parser(handler, line_no);
+    parse_stats* const stats = details::parse_probe::current();
+    for(Iter it = begin_iter; it != end_iter;)
+    {
+        parser.parse_line(*it);
+        details::phase_timer timer(stats, &parse_stats::read_time);
+        ++it;
+    }
+}
+
+/**
+ * @brief Parse in-memory text, see parse_events(Iter, Iter, Handler&, size_t)
+ */
+template <typename CharT, typename Traits, typename Handler>
+void parse_events(std::basic_string_view<CharT, Traits> text, Handler& handler)
+{
+    parse_events(syntax::line_iterator<CharT, Traits>(text.data(), text.data() + text.size()),
+                 syntax::line_iterator<CharT, Traits>(), handler);
+}
+
+/**
+ * @brief Parse stream line by line reusing one buffer, see parse_events(Iter, Iter, Handler&, size_t)
+ */
+template <typename CharT, typename Traits, typename Handler>
+void parse_events(std::basic_istream<CharT, Traits>& is, Handler& handler)
+{
+    event_parser<Handler, CharT, Traits> parser(handler);
+    parse_stats* const stats = details::parse_probe::current();
+    std::basic_string<CharT, Traits> line;
+    while(true)
+    {
+        {
+            details::phase_timer timer(stats, &parse_stats::read_time);
+            if(!std::getline(is, line))
+                break;
+        }
+        parser.parse_line(line);
+    }
+}
+
+}
+
+#endif //INI_SAX_H
@@ -0,0 +1,229 @@
+#ifndef INI_SCAN_H
+#define INI_SCAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define INI_PARSER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled with a target attribute and selected at run time, so no compiler flags are needed
+#if defined(INI_PARSER_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define INI_PARSER_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace ini
+{
+
+namespace syntax
+{
+
+//! Size of blocks searched at once
+constexpr size_t scan_block_size = 64;
+
+namespace details
+{
+
+inline unsigned count_trailing_zeros(uint64_t mask) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned res = 0;
+    for(; !(mask & 1); mask >>= 1)
+        ++res;
+    return res;
+#endif
+}
+
+#ifdef INI_PARSER_AVX2
+inline bool cpu_has_avx2() noexcept
+{
+    return __builtin_cpu_supports("avx2");
+}
+#else
+inline bool cpu_has_avx2() noexcept
+{
+    return false;
+}
+#endif
+
+/**
+ * The first block containing a character
+ * mask is 0 if there is no such block, then block is the end of the searched range
+ */
+struct block_match
+{
+    const char* block;
+    uint64_t mask;
+};
+
+/**
+ * @brief Search blocks for c with mask of one block computed by BlockMask
+ * The last partial block is copied into a zero padded buffer, so nothing is read past last
+ */
+template <typename BlockMask>
+block_match find_in_tail(const char* block, const char* last, char c, BlockMask block_mask) noexcept
+{
+    if(block == last)
+        return {block, 0};
+    char tail[scan_block_size] = {};
+    std::memcpy(tail, block, last - block);
+    const uint64_t mask = block_mask(tail, c);
+    return {mask ? block : last, mask};
+}
+
+inline uint64_t block_mask_scalar(const char* block, char c) noexcept
+{
+    uint64_t res = 0;
+    for(size_t i = 0; i < scan_block_size; ++i)
+        res |= uint64_t(block[i] == c) << i;
+    return res;
+}
+
+inline block_match find_block_scalar(const char* block, const char* last, char c) noexcept
+{
+    for(; size_t(last - block) >= scan_block_size; block += scan_block_size)
+        if(const uint64_t mask = block_mask_scalar(block, c))
+            return {block, mask};
+    return find_in_tail(block, last, c, block_mask_scalar);
+}
+
+#ifdef INI_PARSER_SSE2
+inline uint64_t block_mask_sse2(const char* block, char c) noexcept
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t res = 0;
+    for(size_t part = 0; part < scan_block_size / 16; ++part)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + part * 16));
+        res |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, needle)))) << (part * 16);
+    }
+    return res;
+}
+
+inline block_match find_block_sse2(const char* block, const char* last, char c) noexcept
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    for(; size_t(last - block) >= scan_block_size; block += scan_block_size)
+    {
+        const __m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), needle);
+        const __m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16)), needle);
+        const __m128i eq2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32)), needle);
+        const __m128i eq3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48)), needle);
+        if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3))))
+            return {block, uint64_t(uint32_t(_mm_movemask_epi8(eq0))) | uint64_t(uint32_t(_mm_movemask_epi8(eq1))) << 16 |
+                           uint64_t(uint32_t(_mm_movemask_epi8(eq2))) << 32 | uint64_t(uint32_t(_mm_movemask_epi8(eq3))) << 48};
+    }
+    return find_in_tail(block, last, c, block_mask_sse2);
+}
+#endif
+
+#ifdef INI_PARSER_AVX2
+__attribute__((target("avx2"))) inline uint64_t block_mask_avx2(const char* block, char c) noexcept
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    const __m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), needle);
+    const __m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32)), needle);
+    return uint64_t(uint32_t(_mm256_movemask_epi8(low))) | uint64_t(uint32_t(_mm256_movemask_epi8(high))) << 32;
+}
+
+__attribute__((target("avx2"))) inline block_match find_block_avx2(const char* block, const char* last, char c) noexcept
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    for(; size_t(last - block) >= scan_block_size; block += scan_block_size)
+    {
+        const __m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), needle);
+        const __m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32)), needle);
+        const __m256i any = _mm256_or_si256(low, high);
+        if(!_mm256_testz_si256(any, any))
+            return {block, uint64_t(uint32_t(_mm256_movemask_epi8(low))) | uint64_t(uint32_t(_mm256_movemask_epi8(high))) << 32};
+    }
+    return find_in_tail(block, last, c, block_mask_avx2);
+}
+#endif
+
+using find_block_function = block_match (*)(const char*, const char*, char) noexcept;
+
+inline find_block_function select_find_block() noexcept
+{
+#ifdef INI_PARSER_AVX2
+    if(cpu_has_avx2())
+        return find_block_avx2;
+#endif
+#ifdef INI_PARSER_SSE2
+    return find_block_sse2;
+#else
+    return find_block_scalar;
+#endif
+}
+
+//! The first block of [block, last) containing c
+inline block_match find_block(const char* block, const char* last, char c) noexcept
+{
+    static const find_block_function find = select_find_block();
+    return find(block, last, c);
+}
+
+}
+
+/**
+ * Finder of line ends in a character buffer
+ * Blocks of scan_block_size characters are searched at once. The mask of the block where '\n' was found
+ * is kept, so the following line ends of that block, i.e. ends of short lines, cost a few bit operations.
+ */
+class newline_scanner
+{
+public:
+    newline_scanner() noexcept = default;
+
+    newline_scanner(const char* first, const char* last) noexcept
+        : m_first(first), m_last(last) {}
+
+    //! First '\n' at or after pos or the end of the buffer
+    const char* find(const char* pos) noexcept
+    {
+        if(pos >= m_last)
+            return m_last;
+        const size_t offset = size_t(pos - m_first) % scan_block_size;
+        const char* block = pos - offset;
+        if(block != m_block)
+        {
+            const size_t size = std::min<size_t>(scan_block_size, m_last - block);
+            remember(details::find_block(block, block + size, '\n'));
+        }
+        if(const uint64_t mask = m_mask >> offset)
+            return pos + details::count_trailing_zeros(mask);
+        if(size_t(m_last - block) <= scan_block_size)
+            return m_last;
+
+        const details::block_match match = details::find_block(block + scan_block_size, m_last, '\n');
+        if(!match.mask)
+            return m_last;
+        remember(match);
+        return match.block + details::count_trailing_zeros(match.mask);
+    }
+
+private:
+    void remember(const details::block_match& match) noexcept
+    {
+        m_block = match.mask ? match.block : nullptr;
+        m_mask = match.mask;
+    }
+
+    const char* m_first = nullptr;
+    const char* m_last = nullptr;
+    const char* m_block = nullptr;      //!< block of m_mask, nullptr if nothing is cached
+    uint64_t m_mask = 0;
+};
+
+}
+
+}
+
+#endif //INI_SCAN_H
@@ -0,0 +1,323 @@
+#ifndef INI_SCHEMA_H
+#define INI_SCHEMA_H
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "parser.h"
+
+namespace ini
+{
+
+/**
+ * Location of a struct field in ini file
+ */
+struct field_info
+{
+    std::string_view section;
+    std::string_view name;
+    bool required;      //!< missing value is an error, otherwise the field keeps its initial value
+};
+
+/**
+ * Struct field bound to a value, see field() and required()
+ */
+template <typename T, typename M>
+struct schema_field
+{
+    using member_type = M;
+
+    field_info info;
+    M T::* member;
+};
+
+//! Optional field, its initial value in the struct is the default
+template <typename T, typename M>
+constexpr schema_field<T, M> field(std::string_view section, std::string_view name, M T::* member) noexcept
+{
+    return {{section, name, false}, member};
+}
+
+//! Field which value must be present
+template <typename T, typename M>
+constexpr schema_field<T, M> required(std::string_view section, std::string_view name, M T::* member) noexcept
+{
+    return {{section, name, true}, member};
+}
+
+namespace details
+{
+
+//! Hash of section and value name
+constexpr uint64_t field_key(uint64_t section_hash, std::string_view name) noexcept
+{
+    return mix_hash(section_hash * 31 + hash_string(name));
+}
+
+//! Smallest power of two giving a table at most a quarter full, such tables need few seeds to be collision free
+constexpr size_t perfect_hash_size(size_t count) noexcept
+{
+    size_t res = 1;
+    while(res < count * 4)
+        res *= 2;
+    return res;
+}
+
+}
+
+/**
+ * Description of struct fields and their locations in ini file
+ * Keys are placed into a perfect hash table when the schema is constructed, so for a constexpr schema
+ * finding the field of a value costs two string hashes and one comparison, with no search at run time.
+ * @tparam T struct type
+ * @tparam Fields schema_field for every bound member
+ */
+template <typename T, typename... Fields>
+class schema
+{
+    static constexpr size_t fields_count = sizeof...(Fields);
+    static constexpr size_t slots_count = details::perfect_hash_size(fields_count);
+
+public:
+    using struct_type = T;
+
+    //! Returned by find() for unknown keys
+    static constexpr size_t npos = fields_count;
+
+    /**
+     * @throw std::invalid_argument if two fields have the same location, a compile error for a constexpr schema
+     */
+    constexpr explicit schema(Fields... fields)
+        : m_fields(fields...), m_infos{fields.info...}, m_keys{}, m_slots{}
+    {
+        for(size_t i = 0; i < fields_count; ++i)
+        {
+            m_keys[i] = details::field_key(details::hash_string(m_infos[i].section), m_infos[i].name);
+            for(size_t j = 0; j < i; ++j)
+                if(m_infos[i].section == m_infos[j].section && m_infos[i].name == m_infos[j].name)
+                    throw std::invalid_argument("duplicate schema field");
+        }
+        while(!place(m_seed))
+            ++m_seed;
+    }
+
+    static constexpr size_t size() noexcept { return fields_count; }
+
+    constexpr const field_info& info(size_t index) const noexcept { return m_infos[index]; }
+
+    /**
+     * @brief Find field of value
+     * @param section_hash hash_string() of section, computed once for all values of a section
+     * @return field index or npos
+     */
+    constexpr size_t find(uint64_t section_hash, std::string_view section, std::string_view name) const noexcept
+    {
+        const size_t index = m_slots[slot(details::field_key(section_hash, name), m_seed)];
+        if(index == npos || m_infos[index].name != name || m_infos[index].section != section)
+            return npos;
+        return index;
+    }
+
+    constexpr size_t find(std::string_view section, std::string_view name) const noexcept
+    {
+        return find(details::hash_string(section), section, name);
+    }
+
+    //! Call f with the field at index
+    template <typename F>
+    void visit(size_t index, F&& f) const
+    {
+        visit(index, f, std::index_sequence_for<Fields...>());
+    }
+
+private:
+    static constexpr size_t slot(uint64_t key, uint64_t seed) noexcept
+    {
+        return details::mix_hash(key ^ seed) & (slots_count - 1);
+    }
+
+    //! Try to place all keys into distinct slots
+    constexpr bool place(uint64_t seed)
+    {
+        for(size_t& s: m_slots)
+            s = npos;
+        for(size_t i = 0; i < fields_count; ++i)
+        {
+            size_t& s = m_slots[slot(m_keys[i], seed)];
+            if(s != npos)
+                return false;
+            s = i;
+        }
+        return true;
+    }
+
+    template <typename F, size_t... Is>
+    void visit(size_t index, F& f, std::index_sequence<Is...>) const
+    {
+        ((index == Is ? f(std::get<Is>(m_fields)) : void()), ...);
+    }
+
+    std::tuple<Fields...> m_fields;
+    std::array<field_info, fields_count> m_infos;
+    std::array<uint64_t, fields_count> m_keys;
+    std::array<size_t, slots_count> m_slots;
+    uint64_t m_seed = 0;
+};
+
+//! Make schema of struct T, usually constexpr
+template <typename T, typename... M>
+constexpr schema<T, schema_field<T, M>...> make_schema(schema_field<T, M>... fields)
+{
+    return schema<T, schema_field<T, M>...>(fields...);
+}
+
+namespace details
+{
+
+/**
+ * parse_events() handler converting values of schema fields straight into a struct
+ * Unknown sections and values are skipped, conversion errors are collected. Repeated sections and repeated values
+ * of fields are rejected with the exceptions parse() throws for them.
+ */
+template <typename Schema>
+class schema_binder : public event_handler<char>
+{
+public:
+    using struct_type = typename Schema::struct_type;
+
+    schema_binder(const Schema& schema, struct_type& out) noexcept
+        : m_schema(schema), m_out(out) {}
+
+    void section(size_t line_no, std::string_view name)
+    {
+        // views passed to callbacks don't outlive them
+        m_section.assign(name.data(), name.size());
+        if(!m_sections.insert(m_section).second)
+            throw double_section_definition(line_no, m_section);
+        m_section_hash = hash_string(name);
+    }
+
+    void value(size_t line_no, std::string_view name, std::string_view value)
+    {
+        const size_t index = m_schema.find(m_section_hash, m_section, name);
+        if(index == Schema::npos)
+            return;
+        if(m_found[index])
+            throw double_value_definition(line_no, m_section, std::string(name));
+        m_found[index] = true;
+        m_schema.visit(index, [&](const auto& field)
+        {
+            using member_type = typename std::decay_t<decltype(field)>::member_type;
+            try
+            {
+                m_out.*field.member = ViewValue(value).as<member_type>();
+            }
+            catch(const not_convertible&)
+            {
+                add_error(index, false, line_no);
+            }
+            catch(const std::invalid_argument&)
+            {
+                add_error(index, false, line_no);
+            }
+        });
+    }
+
+    //! Add errors of missing required fields and return all errors
+    std::vector<field_error> finish()
+    {
+        for(size_t i = 0; i < Schema::size(); ++i)
+            if(!m_found[i] && m_schema.info(i).required)
+                add_error(i, true, 0);
+        return std::move(m_errors);
+    }
+
+private:
+    void add_error(size_t index, bool missing, size_t line_no)
+    {
+        const field_info& info = m_schema.info(index);
+        m_errors.push_back({std::string(info.section), std::string(info.name), missing, line_no});
+    }
+
+    const Schema& m_schema;
+    struct_type& m_out;
+    std::string m_section;
+    std::unordered_set<std::string> m_sections;
+    uint64_t m_section_hash = 0;
+    std::array<bool, Schema::size()> m_found{};
+    std::vector<field_error> m_errors;
+};
+
+}
+
+/**
+ * @brief Convert values of text straight into struct fields without building a File
+ * @return fields which are missing or could not be converted, fields without errors are assigned
+ * @throw ini::parsing_error if text contains syntax errors, repeated sections or repeated values of fields
+ */
+template <typename Schema>
+std::vector<field_error> bind(std::string_view text, const Schema& schema, typename Schema::struct_type& out)
+{
+    details::schema_binder<Schema> binder(schema, out);
+    parse_events(text, binder);
+    return binder.finish();
+}
+
+/**
+ * @brief Read stream line by line converting values into struct fields, see bind(std::string_view, ...)
+ */
+template <typename Schema>
+std::vector<field_error> bind(std::istream& is, const Schema& schema, typename Schema::struct_type& out)
+{
+    details::schema_binder<Schema> binder(schema, out);
+    parse_events(is, binder);
+    return binder.finish();
+}
+
+/**
+ * @brief Convert values of a parsed file into struct fields
+ * Every section name is hashed once, values are dispatched by the schema without lookups in the file.
+ * @return fields which are missing or could not be converted, fields without errors are assigned
+ */
+template <typename String, typename Storage, typename Schema>
+std::vector<field_error> bind(const File<String, Storage>& file, const Schema& schema,
+                              typename Schema::struct_type& out)
+{
+    static_assert(std::is_same<typename String::value_type, char>::value, "schemas bind narrow files only");
+
+    details::schema_binder<Schema> binder(schema, out);
+    for(const auto& section: file)
+    {
+        binder.section(0, std::string_view(section.first));
+        for(const auto& value: section.second)
+            binder.value(0, std::string_view(value.first), value.second.view());
+    }
+    return binder.finish();
+}
+
+/**
+ * @brief Make struct from text, stream or parsed file
+ * Fields not present in the source keep the values of a value-initialized struct.
+ * @throw ini::binding_error listing all missing and not convertible fields
+ * @throw ini::parsing_error if text contains syntax errors, repeated sections or repeated values of fields
+ */
+template <typename Source, typename Schema>
+typename Schema::struct_type load(Source&& source, const Schema& schema)
+{
+    typename Schema::struct_type res{};
+    std::vector<field_error> errors = ini::bind(std::forward<Source>(source), schema, res);
+    if(!errors.empty())
+        throw binding_error(std::move(errors));
+    return res;
+}
+
+}
+
+#endif //INI_SCHEMA_H
@@ -0,0 +1,298 @@
+#ifndef INI_SHARED_H
+#define INI_SHARED_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+namespace ini
+{
+
+namespace details
+{
+
+constexpr char shared_magic[8] = {'I', 'N', 'I', 'S', 'H', 'M', '\0', '\0'};
+
+/**
+ * Control segment of shared snapshots
+ * Images are never modified once published, a new generation is a new shared memory object named
+ * after the control segment and the generation, which is switched to by storing the generation.
+ */
+struct shared_control
+{
+    char magic[8];
+    std::atomic<uint64_t> generation;   //!< 0 until the first image is published
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "generation must be lock free to be shared by processes");
+
+inline std::string shared_image_name(const std::string& name, uint64_t generation)
+{
+    return name + "." + std::to_string(generation);
+}
+
+//! Shared memory object descriptor closed on destruction
+class shared_descriptor
+{
+public:
+    shared_descriptor(const std::string& name, int flags, mode_t mode = 0)
+        : m_fd(::shm_open(name.c_str(), flags | O_CLOEXEC, mode)) {}
+
+    shared_descriptor(const shared_descriptor&) = delete;
+    shared_descriptor& operator=(const shared_descriptor&) = delete;
+
+    ~shared_descriptor()
+    {
+        if(m_fd >= 0)
+            ::close(m_fd);
+    }
+
+    int get() const noexcept { return m_fd; }
+    explicit operator bool() const noexcept { return m_fd >= 0; }
+
+private:
+    int m_fd;
+};
+
+/**
+ * Mapping of the control segment
+ */
+class control_mapping
+{
+public:
+    control_mapping() noexcept = default;
+
+    control_mapping(int fd, int protection, const std::string& name)
+    {
+        void* data = ::mmap(nullptr, sizeof(shared_control), protection, MAP_SHARED, fd, 0);
+        if(data == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "could not map '" + name + "'");
+        m_control = static_cast<shared_control*>(data);
+    }
+
+    control_mapping(const control_mapping&) = delete;
+    control_mapping& operator=(const control_mapping&) = delete;
+
+    control_mapping(control_mapping&& other) noexcept
+        : m_control(std::exchange(other.m_control, nullptr)) {}
+
+    control_mapping& operator=(control_mapping&& other) noexcept
+    {
+        if(this != &other)
+        {
+            unmap();
+            m_control = std::exchange(other.m_control, nullptr);
+        }
+        return *this;
+    }
+
+    ~control_mapping() { unmap(); }
+
+    shared_control* operator->() const noexcept { return m_control; }
+
+private:
+    void unmap() noexcept
+    {
+        if(m_control)
+            ::munmap(m_control, sizeof(shared_control));
+        m_control = nullptr;
+    }
+
+    shared_control* m_control = nullptr;
+};
+
+}
+
+/**
+ * Publisher of parsed files for processes sharing one host, e.g. pre-forked workers
+ * Every publish() writes a snapshot image into a new POSIX shared memory object and then switches
+ * the generation stored in the control segment, so readers see either the previous or the new image
+ * and never a partially written one. Pages of an image are shared by all processes mapping it.
+ * There must be one publisher for a name at a time.
+ */
+class SharedSnapshotPublisher
+{
+public:
+    /**
+     * @brief Create or reuse control segment
+     * @param name shared memory name, starts with '/' and has no other slashes
+     * @param mode permissions of the segments, readers need read access
+     * @throw std::system_error if segment could not be created
+     */
+    explicit SharedSnapshotPublisher(std::string name, mode_t mode = 0644)
+        : m_name(std::move(name)), m_mode(mode)
+    {
+        details::shared_descriptor fd(m_name, O_RDWR | O_CREAT, m_mode);
+        if(!fd)
+            throw std::system_error(errno, std::generic_category(), "could not open '" + m_name + "'");
+        struct stat st{};
+        if(::fstat(fd.get(), &st) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not stat '" + m_name + "'");
+        if(static_cast<size_t>(st.st_size) < sizeof(details::shared_control) &&
+           ::ftruncate(fd.get(), sizeof(details::shared_control)) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not resize '" + m_name + "'");
+
+        m_control = details::control_mapping(fd.get(), PROT_READ | PROT_WRITE, m_name);
+        // new segments are zero filled, a restarted publisher continues the generations
+        if(std::memcmp(m_control->magic, details::shared_magic, sizeof(details::shared_magic)) != 0)
+        {
+            m_control->generation.store(0, std::memory_order_relaxed);
+            std::memcpy(m_control->magic, details::shared_magic, sizeof(details::shared_magic));
+        }
+    }
+
+    /**
+     * @brief Publish image of file as the next generation
+     * The previous image is unlinked, processes which have it mapped keep using it until they refresh.
+     * @param source identity of the ini file stored in the image
+     * @return published generation
+     * @throw std::system_error if shared memory could not be written
+     * @throw std::length_error if a name or a value is longer than 4 GB
+     */
+    template <typename String, typename Storage>
+    uint64_t publish(const File<String, Storage>& file, const snapshot_source& source = snapshot_source())
+    {
+        const details::snapshot_parts image = details::make_snapshot(file, source);
+        const uint64_t previous = m_control->generation.load(std::memory_order_relaxed);
+        const uint64_t generation = previous + 1;
+        const std::string image_name = details::shared_image_name(m_name, generation);
+
+        // left by a publisher which crashed before switching the generation
+        ::shm_unlink(image_name.c_str());
+        details::shared_descriptor fd(image_name, O_RDWR | O_CREAT | O_EXCL, m_mode);
+        if(!fd)
+            throw std::system_error(errno, std::generic_category(), "could not create '" + image_name + "'");
+        try
+        {
+            if(::ftruncate(fd.get(), static_cast<off_t>(image.size())) != 0)
+                throw std::system_error(errno, std::generic_category(), "could not resize '" + image_name + "'");
+            void* data = ::mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+            if(data == MAP_FAILED)
+                throw std::system_error(errno, std::generic_category(), "could not map '" + image_name + "'");
+            image.copy_to(static_cast<char*>(data));
+            ::munmap(data, image.size());
+        }
+        catch(...)
+        {
+            ::shm_unlink(image_name.c_str());
+            throw;
+        }
+
+        m_control->generation.store(generation, std::memory_order_release);
+        if(previous != 0)
+            ::shm_unlink(details::shared_image_name(m_name, previous).c_str());
+        return generation;
+    }
+
+    //! Last published generation, 0 if nothing was published
+    uint64_t generation() const noexcept { return m_control->generation.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Remove control segment and the current image
+     * Attached readers keep their mappings, new readers could not attach.
+     */
+    void unlink() const noexcept
+    {
+        if(const uint64_t current = generation())
+            ::shm_unlink(details::shared_image_name(m_name, current).c_str());
+        ::shm_unlink(m_name.c_str());
+    }
+
+    const std::string& name() const noexcept { return m_name; }
+
+private:
+    std::string m_name;
+    mode_t m_mode;
+    details::control_mapping m_control;
+};
+
+/**
+ * Read-only view of the image published by SharedSnapshotPublisher
+ * The current Snapshot keeps its image mapped, so lookups never see concurrent updates.
+ * refresh() switches to the latest generation, sections and values of the previous snapshot are
+ * invalidated by it. The object is not thread safe, every thread or process needs its own.
+ */
+class SharedSnapshot
+{
+public:
+    /**
+     * @brief Attach to published images and map the current one
+     * @param name name given to the publisher
+     * @throw std::system_error if control segment does not exist or could not be mapped
+     * @throw ini::invalid_snapshot if image is damaged
+     */
+    explicit SharedSnapshot(const std::string& name)
+        : m_name(name)
+    {
+        details::shared_descriptor fd(m_name, O_RDONLY);
+        if(!fd)
+            throw std::system_error(errno, std::generic_category(), "could not open '" + m_name + "'");
+        struct stat st{};
+        if(::fstat(fd.get(), &st) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not stat '" + m_name + "'");
+        if(static_cast<size_t>(st.st_size) < sizeof(details::shared_control))
+            throw invalid_snapshot("control segment is too small");
+        m_control = details::control_mapping(fd.get(), PROT_READ, m_name);
+        if(std::memcmp(m_control->magic, details::shared_magic, sizeof(details::shared_magic)) != 0)
+            throw invalid_snapshot("wrong magic of control segment");
+        refresh();
+    }
+
+    //! Image of generation(), empty before the first publish
+    const Snapshot& snapshot() const noexcept { return m_snapshot; }
+
+    //! Generation of snapshot()
+    uint64_t generation() const noexcept { return m_generation; }
+
+    //! Check that no newer generation was published
+    bool is_current() const noexcept
+    {
+        return m_control->generation.load(std::memory_order_acquire) == m_generation;
+    }
+
+    /**
+     * @brief Map the latest image if it differs from the current one
+     * @return true if snapshot was replaced
+     * @throw std::system_error if image could not be mapped
+     * @throw ini::invalid_snapshot if image is damaged
+     */
+    bool refresh()
+    {
+        while(true)
+        {
+            const uint64_t generation = m_control->generation.load(std::memory_order_acquire);
+            if(generation == m_generation)
+                return false;
+            const std::string image_name = details::shared_image_name(m_name, generation);
+            details::shared_descriptor fd(image_name, O_RDONLY);
+            if(!fd)
+            {
+                // replaced by a newer generation and unlinked before it was opened
+                if(errno == ENOENT && m_control->generation.load(std::memory_order_acquire) != generation)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "could not open '" + image_name + "'");
+            }
+            m_snapshot = Snapshot(details::mapped_file(fd.get(), image_name));
+            m_generation = generation;
+            return true;
+        }
+    }
+
+private:
+    std::string m_name;
+    details::control_mapping m_control;
+    Snapshot m_snapshot;
+    uint64_t m_generation = 0;
+};
+
+}
+
+#endif //INI_SHARED_H
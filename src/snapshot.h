@@ -0,0 +1,603 @@
+#ifndef INI_SNAPSHOT_H
+#define INI_SNAPSHOT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "parser.h"
+#include "mapping.h"
+#include "storage.h"
+
+namespace ini
+{
+
+/**
+ * Identity of the ini file a snapshot was made from
+ */
+struct snapshot_source
+{
+    uint64_t mtime = 0;     //!< modification time in nanoseconds
+    uint64_t size = 0;      //!< size in bytes
+    uint64_t hash = 0;      //!< FNV-1a hash of the contents
+};
+
+namespace details
+{
+
+constexpr char snapshot_magic[8] = {'I', 'N', 'I', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t snapshot_version = 1;
+constexpr uint32_t snapshot_byte_order = 0x01020304;
+
+/**
+ * Binary image layout: header, section records sorted by name, value records sorted by name within
+ * every section, characters of all names and values. Offsets are relative to the beginning of characters.
+ */
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    snapshot_source source;
+    uint64_t sections_count;
+    uint64_t values_count;
+    uint64_t strings_size;
+};
+
+struct snapshot_section
+{
+    uint64_t name_offset;
+    uint64_t first_value;
+    uint32_t name_size;
+    uint32_t values_count;
+};
+
+struct snapshot_value
+{
+    uint64_t name_offset;
+    uint64_t value_offset;
+    uint32_t name_size;
+    uint32_t value_size;
+};
+
+inline uint64_t modification_time(const struct stat& st) noexcept
+{
+    return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+/**
+ * @brief Stat and map file
+ * Modification time is taken before mapping, so a change made in between makes the snapshot look outdated
+ * @throw std::system_error if file could not be read
+ */
+inline snapshot_source map_source(const std::string& filename, mapped_file& mapping)
+{
+    struct stat st{};
+    if(::stat(filename.c_str(), &st) != 0)
+        throw std::system_error(errno, std::generic_category(), "could not stat '" + filename + "'");
+    mapping = mapped_file(filename);
+
+    snapshot_source res;
+    res.mtime = modification_time(st);
+    res.size = mapping.size();
+    res.hash = hash_string(mapping.view());
+    return res;
+}
+
+/**
+ * Read-only access to a mapped image, all reads are bounds checked
+ * Refers to mapped memory only, so copies stay valid while the mapping exists
+ */
+class snapshot_image
+{
+public:
+    snapshot_image() noexcept = default;
+
+    explicit snapshot_image(const mapped_file& mapping)
+    {
+        if(mapping.size() < sizeof(snapshot_header))
+            throw invalid_snapshot("file is too small");
+        m_header = reinterpret_cast<const snapshot_header*>(mapping.data());
+        if(std::memcmp(m_header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+            throw invalid_snapshot("wrong magic");
+        if(m_header->version != snapshot_version || m_header->byte_order != snapshot_byte_order)
+            throw invalid_snapshot("unsupported version or byte order");
+
+        // every part is compared with the rest of the mapping before it is added, so sizes could not wrap around
+        uint64_t remaining = mapping.size() - sizeof(snapshot_header);
+        if(m_header->sections_count > remaining / sizeof(snapshot_section))
+            throw invalid_snapshot("wrong size");
+        remaining -= m_header->sections_count * sizeof(snapshot_section);
+        if(m_header->values_count > remaining / sizeof(snapshot_value))
+            throw invalid_snapshot("wrong size");
+        remaining -= m_header->values_count * sizeof(snapshot_value);
+        if(m_header->strings_size != remaining)
+            throw invalid_snapshot("wrong size");
+
+        m_sections = reinterpret_cast<const snapshot_section*>(m_header + 1);
+        m_values = reinterpret_cast<const snapshot_value*>(m_sections + m_header->sections_count);
+        m_strings = reinterpret_cast<const char*>(m_values + m_header->values_count);
+    }
+
+    const snapshot_header& header() const noexcept { return *m_header; }
+
+    const snapshot_section* sections() const noexcept { return m_sections; }
+
+    //! Values of section
+    const snapshot_value* values(const snapshot_section& section) const
+    {
+        if(section.first_value > m_header->values_count ||
+           section.values_count > m_header->values_count - section.first_value)
+            throw invalid_snapshot("value index out of range");
+        return m_values + section.first_value;
+    }
+
+    std::string_view string(uint64_t offset, uint32_t size) const
+    {
+        if(offset > m_header->strings_size || size > m_header->strings_size - offset)
+            throw invalid_snapshot("string out of range");
+        return std::string_view(m_strings + offset, size);
+    }
+
+private:
+    const snapshot_header* m_header = nullptr;
+    const snapshot_section* m_sections = nullptr;
+    const snapshot_value* m_values = nullptr;
+    const char* m_strings = nullptr;
+};
+
+//! Binary search of a record by name in a sorted table
+template <typename Record>
+const Record* find_record(const snapshot_image& image, const Record* first, const Record* last, std::string_view name)
+{
+    const Record* res = std::lower_bound(first, last, name, [&image](const Record& record, std::string_view key)
+    {
+        return image.string(record.name_offset, record.name_size) < key;
+    });
+    return res != last && image.string(res->name_offset, res->name_size) == name ? res : last;
+}
+
+/**
+ * Iterator over records producing pairs of name and mapped object on dereference
+ */
+template <typename Record, typename Mapped>
+class snapshot_iterator
+{
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<std::string_view, Mapped>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    struct pointer
+    {
+        value_type value;
+        const value_type* operator->() const noexcept { return &value; }
+    };
+
+    snapshot_iterator() noexcept = default;
+    snapshot_iterator(const snapshot_image& image, const Record* record) noexcept
+        : m_image(image), m_record(record) {}
+
+    reference operator*() const
+    {
+        return value_type(m_image.string(m_record->name_offset, m_record->name_size), Mapped(m_image, *m_record));
+    }
+    pointer operator->() const { return pointer{**this}; }
+
+    snapshot_iterator& operator++() noexcept { ++m_record; return *this; }
+    snapshot_iterator operator++(int) noexcept { return snapshot_iterator(m_image, m_record++); }
+
+    friend bool operator==(const snapshot_iterator& l, const snapshot_iterator& r) noexcept { return l.m_record == r.m_record; }
+    friend bool operator!=(const snapshot_iterator& l, const snapshot_iterator& r) noexcept { return l.m_record != r.m_record; }
+
+private:
+    snapshot_image m_image;
+    const Record* m_record = nullptr;
+};
+
+//! Value of snapshot, the view refers to mapped memory
+struct snapshot_value_view : ViewValue
+{
+    snapshot_value_view(const snapshot_image& image, const snapshot_value& value)
+        : ViewValue(image.string(value.value_offset, value.value_size)) {}
+};
+
+//! Write all bytes or throw
+inline void write_all(std::FILE* file, const void* data, size_t size, const std::string& filename)
+{
+    if(size != 0 && std::fwrite(data, 1, size, file) != size)
+        throw std::system_error(errno, std::generic_category(), "could not write '" + filename + "'");
+}
+
+}
+
+/**
+ * @brief Get identity of file
+ * @throw std::system_error if file could not be read
+ */
+inline snapshot_source source_of(const std::string& filename)
+{
+    details::mapped_file mapping;
+    return details::map_source(filename, mapping);
+}
+
+namespace details
+{
+
+enum class source_status
+{
+    current,    //!< same size and modification time
+    touched,    //!< modified, but contents are the same
+    changed
+};
+
+/**
+ * @brief Compare identity of file recorded in a snapshot with the file
+ * Equal modification time and size are trusted, otherwise contents hash is compared
+ * @param actual receives identity of the file if its contents were hashed
+ */
+inline source_status check_source(const snapshot_source& source, const std::string& filename, snapshot_source& actual)
+{
+    struct stat st{};
+    if(::stat(filename.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) != source.size)
+        return source_status::changed;
+    if(modification_time(st) == source.mtime)
+        return source_status::current;
+    actual = source_of(filename);
+    return actual.size == source.size && actual.hash == source.hash ? source_status::touched : source_status::changed;
+}
+
+/**
+ * @brief Write file through a temporary one which then replaces it, so readers never see a partial file
+ * The temporary name is unique among processes and among threads of a process, so concurrent writers
+ * of the same file do not share it, the last rename wins.
+ * @param write function writing contents by write_all(out, data, size, temp_filename)
+ */
+template <typename F>
+void replace_file(const std::string& filename, F write)
+{
+    static std::atomic<uint64_t> temp_counter{0};
+    const std::string temp_filename = filename + ".tmp" + std::to_string(::getpid()) + "." +
+                                      std::to_string(temp_counter.fetch_add(1, std::memory_order_relaxed));
+    std::FILE* out = std::fopen(temp_filename.c_str(), "wb");
+    if(!out)
+        throw std::system_error(errno, std::generic_category(), "could not create '" + temp_filename + "'");
+    try
+    {
+        write(out, temp_filename);
+        if(std::fclose(std::exchange(out, nullptr)) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not write '" + temp_filename + "'");
+        if(std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+            throw std::system_error(errno, std::generic_category(), "could not replace '" + filename + "'");
+    }
+    catch(...)
+    {
+        if(out)
+            std::fclose(out);
+        std::remove(temp_filename.c_str());
+        throw;
+    }
+}
+
+}
+
+/**
+ * Section of a snapshot, a lightweight view into mapped memory
+ * Lookups do a binary search and don't allocate, values are ViewValue referring to mapped memory.
+ * Sections, values and iterators stay valid while the snapshot lives, even if it is moved.
+ */
+class SnapshotSection
+{
+public:
+    using const_iterator = details::snapshot_iterator<details::snapshot_value, details::snapshot_value_view>;
+    using iterator = const_iterator;
+
+    SnapshotSection(const details::snapshot_image& image, const details::snapshot_section& section)
+        : m_image(image), m_first(image.values(section)), m_last(m_first + section.values_count) {}
+
+    const_iterator begin() const noexcept { return const_iterator(m_image, m_first); }
+    const_iterator end() const noexcept { return const_iterator(m_image, m_last); }
+    size_t size() const noexcept { return m_last - m_first; }
+
+    const_iterator find(std::string_view name) const
+    {
+        return const_iterator(m_image, details::find_record(m_image, m_first, m_last, name));
+    }
+
+    /**
+     * @brief Get value
+     * @throw std::out_of_range if there is no such value
+     */
+    ViewValue at(std::string_view name) const
+    {
+        const details::snapshot_value* res = details::find_record(m_image, m_first, m_last, name);
+        if(res == m_last)
+            throw std::out_of_range("SnapshotSection::at");
+        return details::snapshot_value_view(m_image, *res);
+    }
+
+    template <typename T>
+    T get(std::string_view name, const T& default_value = T()) const
+    {
+        const details::snapshot_value* res = details::find_record(m_image, m_first, m_last, name);
+        if(res == m_last)
+            return default_value;
+        return details::snapshot_value_view(m_image, *res).as<T>();
+    }
+
+private:
+    details::snapshot_image m_image;
+    const details::snapshot_value* m_first;
+    const details::snapshot_value* m_last;
+};
+
+/**
+ * Memory mapped binary image of a parsed file
+ * Loading validates the header only, every lookup is bounds checked.
+ * Sections and values refer to the mapping and are valid while the snapshot lives.
+ */
+class Snapshot
+{
+public:
+    using const_iterator = details::snapshot_iterator<details::snapshot_section, SnapshotSection>;
+    using iterator = const_iterator;
+
+    Snapshot() noexcept = default;
+
+    /**
+     * @brief Map snapshot file
+     * @throw std::system_error if file could not be mapped
+     * @throw ini::invalid_snapshot if file is not a snapshot of a supported version
+     */
+    explicit Snapshot(const std::string& filename)
+        : m_mapping(filename), m_image(m_mapping) {}
+
+    /**
+     * @brief Take over mapped image, e.g. of a shared memory object
+     * @throw ini::invalid_snapshot if mapping is not a snapshot of a supported version
+     */
+    explicit Snapshot(details::mapped_file&& mapping)
+        : m_mapping(std::move(mapping)), m_image(m_mapping) {}
+
+    // image points into the mapping which stays at the same address when moved
+    Snapshot(Snapshot&&) noexcept = default;
+    Snapshot& operator=(Snapshot&&) noexcept = default;
+
+    const_iterator begin() const noexcept { return const_iterator(m_image, sections_begin()); }
+    const_iterator end() const noexcept { return const_iterator(m_image, sections_end()); }
+    size_t size() const noexcept { return sections_end() - sections_begin(); }
+
+    const_iterator find(std::string_view name) const
+    {
+        return const_iterator(m_image, details::find_record(m_image, sections_begin(), sections_end(), name));
+    }
+
+    /**
+     * @brief Get section
+     * @throw std::out_of_range if there is no such section
+     */
+    SnapshotSection at(std::string_view name) const
+    {
+        const details::snapshot_section* res = details::find_record(m_image, sections_begin(), sections_end(), name);
+        if(res == sections_end())
+            throw std::out_of_range("Snapshot::at");
+        return SnapshotSection(m_image, *res);
+    }
+
+    //! Identity of the file the snapshot was made from
+    snapshot_source source() const noexcept
+    {
+        return m_mapping.data() ? m_image.header().source : snapshot_source();
+    }
+
+    /**
+     * @brief Check that snapshot was made from the current contents of file
+     * Equal modification time and size are trusted, otherwise contents hash is compared
+     */
+    bool is_current(const std::string& filename) const
+    {
+        if(!m_mapping.data())
+            return false;
+        snapshot_source actual;
+        return details::check_source(m_image.header().source, filename, actual) != details::source_status::changed;
+    }
+
+private:
+    const details::snapshot_section* sections_begin() const noexcept
+    {
+        return m_mapping.data() ? m_image.sections() : nullptr;
+    }
+
+    const details::snapshot_section* sections_end() const noexcept
+    {
+        return m_mapping.data() ? m_image.sections() + m_image.header().sections_count : nullptr;
+    }
+
+    details::mapped_file m_mapping;
+    details::snapshot_image m_image;
+};
+
+namespace details
+{
+
+/**
+ * Parts of a binary image in the order they are stored
+ */
+struct snapshot_parts
+{
+    snapshot_header header{};
+    std::vector<snapshot_section> sections;
+    std::vector<snapshot_value> values;
+    std::string strings;
+
+    size_t size() const noexcept
+    {
+        return sizeof(header) + sections.size() * sizeof(snapshot_section) + values.size() * sizeof(snapshot_value) +
+               strings.size();
+    }
+
+    //! Copy image into size() bytes of memory
+    void copy_to(char* out) const noexcept
+    {
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        if(!sections.empty())
+            std::memcpy(out, sections.data(), sections.size() * sizeof(snapshot_section));
+        out += sections.size() * sizeof(snapshot_section);
+        if(!values.empty())
+            std::memcpy(out, values.data(), values.size() * sizeof(snapshot_value));
+        out += values.size() * sizeof(snapshot_value);
+        if(!strings.empty())
+            std::memcpy(out, strings.data(), strings.size());
+    }
+};
+
+/**
+ * @brief Build binary image of file
+ * @throw std::length_error if a name or a value is longer than 4 GB
+ */
+template <typename String, typename Storage>
+snapshot_parts make_snapshot(const File<String, Storage>& file, const snapshot_source& source)
+{
+    static_assert(std::is_same<typename String::value_type, char>::value, "snapshots store narrow strings only");
+
+    using entry = std::pair<std::string_view, const void*>;
+    const auto by_name = [](const entry& l, const entry& r) { return l.first < r.first; };
+
+    snapshot_parts res;
+    const auto add_string = [&res](std::string_view str, uint64_t& offset, uint32_t& size)
+    {
+        if(str.size() > UINT32_MAX)
+            throw std::length_error("snapshot string is too long");
+        offset = res.strings.size();
+        size = static_cast<uint32_t>(str.size());
+        res.strings.append(str.data(), str.size());
+    };
+
+    std::vector<entry> section_entries;
+    for(const auto& section: file)
+        section_entries.emplace_back(std::string_view(section.first), &section.second);
+    std::sort(section_entries.begin(), section_entries.end(), by_name);
+
+    std::vector<entry> value_entries;
+    for(const entry& section_entry: section_entries)
+    {
+        const auto& section = *static_cast<const Section<String, Storage>*>(section_entry.second);
+        value_entries.clear();
+        for(const auto& value: section)
+            value_entries.emplace_back(std::string_view(value.first), &value.second);
+        std::sort(value_entries.begin(), value_entries.end(), by_name);
+        if(value_entries.size() > UINT32_MAX)
+            throw std::length_error("too many values in snapshot section");
+
+        snapshot_section record{};
+        add_string(section_entry.first, record.name_offset, record.name_size);
+        record.first_value = res.values.size();
+        record.values_count = static_cast<uint32_t>(value_entries.size());
+        res.sections.push_back(record);
+
+        for(const entry& value_entry: value_entries)
+        {
+            snapshot_value value{};
+            add_string(value_entry.first, value.name_offset, value.name_size);
+            add_string(static_cast<const BasicValue<String>*>(value_entry.second)->view(), value.value_offset, value.value_size);
+            res.values.push_back(value);
+        }
+    }
+
+    snapshot_header& header = res.header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.byte_order = snapshot_byte_order;
+    header.source = source;
+    header.sections_count = res.sections.size();
+    header.values_count = res.values.size();
+    header.strings_size = res.strings.size();
+    return res;
+}
+
+}
+
+/**
+ * @brief Write binary image of file
+ * Image is written to a temporary file which then replaces filename, so readers never see a partial image.
+ * @param source identity of the ini file stored in the image
+ * @throw std::system_error if file could not be written
+ * @throw std::length_error if a name or a value is longer than 4 GB
+ */
+template <typename String, typename Storage>
+void write_snapshot(const File<String, Storage>& file, const std::string& filename,
+                    const snapshot_source& source = snapshot_source())
+{
+    const details::snapshot_parts image = details::make_snapshot(file, source);
+    details::replace_file(filename, [&image](std::FILE* out, const std::string& temp_filename)
+    {
+        details::write_all(out, &image.header, sizeof(image.header), temp_filename);
+        details::write_all(out, image.sections.data(), image.sections.size() * sizeof(details::snapshot_section), temp_filename);
+        details::write_all(out, image.values.data(), image.values.size() * sizeof(details::snapshot_value), temp_filename);
+        details::write_all(out, image.strings.data(), image.strings.size(), temp_filename);
+    });
+}
+
+/**
+ * @brief Load snapshot of ini file, parse the file and write a new snapshot if it is missing or outdated
+ * If the ini file was only touched, the identity recorded in the snapshot is updated, so the next load
+ * trusts the modification time again instead of hashing the file.
+ * @param filename ini file
+ * @param snapshot_filename snapshot cache
+ * @throw std::system_error if ini file could not be read or snapshot could not be written
+ * @throw ini::parsing_error if ini file contains errors
+ */
+inline Snapshot load_snapshot(const std::string& filename, const std::string& snapshot_filename)
+{
+    try
+    {
+        details::mapped_file mapping(snapshot_filename);
+        const details::snapshot_image image(mapping);
+        snapshot_source actual;
+        switch(details::check_source(image.header().source, filename, actual))
+        {
+        case details::source_status::current:
+            return Snapshot(std::move(mapping));
+        case details::source_status::touched:
+            try
+            {
+                details::snapshot_header header = image.header();
+                header.source = actual;
+                details::replace_file(snapshot_filename, [&](std::FILE* out, const std::string& temp_filename)
+                {
+                    details::write_all(out, &header, sizeof(header), temp_filename);
+                    details::write_all(out, mapping.data() + sizeof(header), mapping.size() - sizeof(header), temp_filename);
+                });
+            }
+            catch(const std::system_error&) {}  // the snapshot is still valid, only the next check is slower
+            return Snapshot(std::move(mapping));
+        case details::source_status::changed:
+            break;
+        }
+    }
+    catch(const std::system_error&) {}
+    catch(const invalid_snapshot&) {}
+
+    details::mapped_file mapping;
+    const snapshot_source source = details::map_source(filename, mapping);
+
+    File<std::string_view> file;
+    parse(syntax::line_iterator<char>(mapping.data(), mapping.data() + mapping.size()), syntax::line_iterator<char>(), file);
+    write_snapshot(file, snapshot_filename, source);
+    return Snapshot(snapshot_filename);
+}
+
+}
+
+#endif //INI_SNAPSHOT_H
@@ -0,0 +1,343 @@
+#ifndef INI_STATS_H
+#define INI_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+/**
+ * Set to 1 to compile parse() and BasicValue::as() with statistics hooks, see stats_observer
+ * With 0 the hooks are removed at compile time.
+ */
+#ifndef INI_PARSER_STATS
+#define INI_PARSER_STATS 0
+#endif
+
+namespace ini
+{
+
+/**
+ * Statistics of one parse()
+ * Timings are summed over lines, so they don't include time between parse() calls of the input iterators.
+ * parse_parallel() sums them over its threads too, so they could exceed total_time.
+ */
+struct parse_stats
+{
+    std::chrono::nanoseconds read_time{0};      //!< getting lines: reading and splitting streams, splitting buffers
+    std::chrono::nanoseconds lex_time{0};       //!< classifying lines and locating their tokens
+    std::chrono::nanoseconds insert_time{0};    //!< adding sections and values into the file
+    std::chrono::nanoseconds total_time{0};
+    size_t lines = 0;
+    size_t sections = 0;
+    size_t values = 0;
+    size_t comments = 0;
+    size_t errors = 0;
+    size_t bytes = 0;               //!< characters of lines including line terminators
+    size_t allocations = 0;         //!< see stats_observer::allocation_counters()
+    size_t allocated_bytes = 0;
+
+    parse_stats& operator+=(const parse_stats& other) noexcept
+    {
+        read_time += other.read_time;
+        lex_time += other.lex_time;
+        insert_time += other.insert_time;
+        total_time += other.total_time;
+        lines += other.lines;
+        sections += other.sections;
+        values += other.values;
+        comments += other.comments;
+        errors += other.errors;
+        bytes += other.bytes;
+        allocations += other.allocations;
+        allocated_bytes += other.allocated_bytes;
+        return *this;
+    }
+};
+
+/**
+ * Numbers of allocations and allocated bytes since some moment, only differences are used
+ */
+struct allocation_counters
+{
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+/**
+ * Receiver of statistics, install with set_stats_observer()
+ * Callbacks are called on the threads which parse and convert, concurrently, and must not throw.
+ * Nothing is reported unless the library is compiled with INI_PARSER_STATS set to 1.
+ */
+class stats_observer
+{
+public:
+    virtual ~stats_observer() = default;
+
+    //! Called when parse() of a File returns or throws
+    virtual void parsed(const parse_stats& /*stats*/) {}
+
+    //! Called after every BasicValue::as() conversion of a non-empty value
+    virtual void converted(const std::type_info& /*type*/, std::chrono::nanoseconds /*time*/, bool /*success*/) {}
+
+    /**
+     * @brief Current allocation counters, sampled before and after parse()
+     * The library has no access to the heap, so by default allocations are not counted. Override to take them
+     * from the allocator of the file, a counting std::pmr::memory_resource or the malloc implementation.
+     */
+    virtual allocation_counters allocations() const { return {}; }
+};
+
+namespace details
+{
+
+constexpr bool stats_enabled = INI_PARSER_STATS != 0;
+
+inline std::atomic<stats_observer*>& observer_slot() noexcept
+{
+    static std::atomic<stats_observer*> res{nullptr};
+    return res;
+}
+
+}
+
+//! Install observer for all threads, nullptr removes it; the observer must outlive all reporting calls
+inline void set_stats_observer(stats_observer* observer) noexcept
+{
+    details::observer_slot().store(observer, std::memory_order_release);
+}
+
+/**
+ * Observer accumulating statistics of all parses and conversions
+ */
+class stats_collector : public stats_observer
+{
+public:
+    struct conversion_counts
+    {
+        size_t count = 0;
+        size_t failures = 0;
+        std::chrono::nanoseconds time{0};
+    };
+
+    void parsed(const parse_stats& stats) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_parses;
+        m_totals += stats;
+    }
+
+    void converted(const std::type_info& type, std::chrono::nanoseconds time, bool success) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        conversion_counts& counts = m_conversions[std::type_index(type)];
+        ++counts.count;
+        counts.failures += !success;
+        counts.time += time;
+    }
+
+    //! Number of parse() calls
+    size_t parses() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_parses;
+    }
+
+    //! Sum of statistics of all parse() calls
+    parse_stats totals() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_totals;
+    }
+
+    std::map<std::type_index, conversion_counts> conversions() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_conversions;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_parses = 0;
+        m_totals = parse_stats();
+        m_conversions.clear();
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    size_t m_parses = 0;
+    parse_stats m_totals;
+    std::map<std::type_index, conversion_counts> m_conversions;
+};
+
+namespace details
+{
+
+/**
+ * Statistics of parse() running on the calling thread
+ * Only the outermost probe of a thread is active, so nested parse() calls are reported once.
+ */
+class parse_probe
+{
+    using clock = std::chrono::steady_clock;
+public:
+    parse_probe() noexcept
+    {
+        if constexpr (stats_enabled)
+        {
+            if(current_slot())
+                return;
+            m_observer = observer_slot().load(std::memory_order_acquire);
+            if(!m_observer)
+                return;
+            current_slot() = &m_stats;
+            m_allocations = m_observer->allocations();
+            m_start = clock::now();
+        }
+    }
+
+    parse_probe(const parse_probe&) = delete;
+    parse_probe& operator=(const parse_probe&) = delete;
+
+    ~parse_probe()
+    {
+        if constexpr (stats_enabled)
+        {
+            if(!m_observer)
+                return;
+            m_stats.total_time = clock::now() - m_start;
+            const allocation_counters allocations = m_observer->allocations();
+            m_stats.allocations = allocations.allocations - m_allocations.allocations;
+            m_stats.allocated_bytes = allocations.bytes - m_allocations.bytes;
+            current_slot() = nullptr;
+            m_observer->parsed(m_stats);
+        }
+    }
+
+    //! Statistics of the active probe of the calling thread or nullptr
+    static parse_stats* current() noexcept
+    {
+        if constexpr (stats_enabled)
+            return current_slot();
+        return nullptr;
+    }
+
+    /**
+     * Part of parse() running on another thread, its statistics are collected into stats for the scope
+     * Does nothing if stats is null or a probe is active on the thread. The parse() running the part adds
+     * stats to its own ones after the thread is joined.
+     */
+    class part
+    {
+    public:
+        explicit part(parse_stats* stats) noexcept
+        {
+            if constexpr (stats_enabled)
+            {
+                if(!stats || current_slot())
+                    return;
+                current_slot() = stats;
+                m_active = true;
+            }
+        }
+
+        part(const part&) = delete;
+        part& operator=(const part&) = delete;
+
+        ~part()
+        {
+            if(m_active)
+                current_slot() = nullptr;
+        }
+
+    private:
+        bool m_active = false;
+    };
+
+private:
+    static parse_stats*& current_slot() noexcept
+    {
+        thread_local parse_stats* res = nullptr;
+        return res;
+    }
+
+    stats_observer* m_observer = nullptr;
+    parse_stats m_stats;
+    allocation_counters m_allocations;
+    clock::time_point m_start;
+};
+
+/**
+ * Adds time of its scope to a phase of stats, does nothing if stats is null
+ */
+class phase_timer
+{
+    using clock = std::chrono::steady_clock;
+public:
+    phase_timer(parse_stats* stats, std::chrono::nanoseconds parse_stats::* phase) noexcept
+        : m_stats(stats), m_phase(phase)
+    {
+        if(m_stats)
+            m_start = clock::now();
+    }
+
+    phase_timer(const phase_timer&) = delete;
+    phase_timer& operator=(const phase_timer&) = delete;
+
+    ~phase_timer()
+    {
+        if(m_stats)
+            m_stats->*m_phase += clock::now() - m_start;
+    }
+
+private:
+    parse_stats* m_stats;
+    std::chrono::nanoseconds parse_stats::* m_phase;
+    clock::time_point m_start;
+};
+
+/**
+ * Reports time and result of one conversion to T, the conversion is failed unless succeeded() is called
+ */
+template <typename T>
+class conversion_probe
+{
+    using clock = std::chrono::steady_clock;
+public:
+    conversion_probe() noexcept
+    {
+        if constexpr (stats_enabled)
+        {
+            m_observer = observer_slot().load(std::memory_order_acquire);
+            if(m_observer)
+                m_start = clock::now();
+        }
+    }
+
+    conversion_probe(const conversion_probe&) = delete;
+    conversion_probe& operator=(const conversion_probe&) = delete;
+
+    void succeeded() noexcept { m_success = true; }
+
+    ~conversion_probe()
+    {
+        if constexpr (stats_enabled)
+            if(m_observer)
+                m_observer->converted(typeid(T), clock::now() - m_start, m_success);
+    }
+
+private:
+    stats_observer* m_observer = nullptr;
+    clock::time_point m_start;
+    bool m_success = false;
+};
+
+}
+
+}
+
+#endif //INI_STATS_H
@@ -0,0 +1,582 @@
+#ifndef INI_STORAGE_H
+#define INI_STORAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ini
+{
+
+namespace details
+{
+
+/**
+ * FNV-1a hash of a character sequence
+ */
+template <typename CharT, typename Traits>
+constexpr uint64_t hash_string(std::basic_string_view<CharT, Traits> str) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(CharT c: str)
+    {
+        hash ^= static_cast<std::make_unsigned_t<CharT>>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//! Finalizer of splitmix64, spreads every input bit over the whole result
+constexpr uint64_t mix_hash(uint64_t hash) noexcept
+{
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+/**
+ * Append-only storage of strings packed into large blocks
+ * Views returned by intern() stay valid until the pool is cleared or destroyed, moving the pool keeps them valid
+ */
+template <typename CharT, typename Traits, typename Allocator>
+class string_pool
+{
+public:
+    using view_type = std::basic_string_view<CharT, Traits>;
+    using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<CharT>;
+
+    explicit string_pool(const allocator_type& alloc = allocator_type())
+        : m_blocks(typename std::allocator_traits<Allocator>::template rebind_alloc<block>(alloc)), m_alloc(alloc) {}
+
+    string_pool(const string_pool&) = delete;
+    string_pool& operator=(const string_pool&) = delete;
+
+    string_pool(string_pool&& other) noexcept
+        : m_blocks(std::move(other.m_blocks)), m_used(std::exchange(other.m_used, 0)), m_alloc(other.m_alloc)
+    {
+        other.m_blocks.clear();
+    }
+
+    string_pool& operator=(string_pool&& other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            m_blocks = std::move(other.m_blocks);
+            other.m_blocks.clear();
+            m_used = std::exchange(other.m_used, 0);
+        }
+        return *this;
+    }
+
+    ~string_pool() { clear(); }
+
+    //! Copy string into the pool
+    view_type intern(view_type str)
+    {
+        if(str.empty())
+            return view_type();
+        if(m_blocks.empty() || m_blocks.back().size - m_used < str.size())
+        {
+            size_t size = m_blocks.empty() ? min_block_size : std::min(m_blocks.back().size * 2, max_block_size);
+            size = std::max(size, str.size());
+            m_blocks.push_back(block{std::allocator_traits<allocator_type>::allocate(m_alloc, size), size});
+            m_used = 0;
+        }
+        CharT* data = m_blocks.back().data + m_used;
+        Traits::copy(data, str.data(), str.size());
+        m_used += str.size();
+        return view_type(data, str.size());
+    }
+
+    void clear() noexcept
+    {
+        for(const block& b: m_blocks)
+            std::allocator_traits<allocator_type>::deallocate(m_alloc, b.data, b.size);
+        m_blocks.clear();
+        m_used = 0;
+    }
+
+    //! Number of characters allocated by the pool
+    size_t capacity() const noexcept
+    {
+        size_t res = 0;
+        for(const block& b: m_blocks)
+            res += b.size;
+        return res;
+    }
+
+private:
+    static constexpr size_t min_block_size = 256;
+    static constexpr size_t max_block_size = 64 * 1024;
+
+    struct block
+    {
+        CharT* data;
+        size_t size;
+    };
+
+    std::vector<block, typename std::allocator_traits<Allocator>::template rebind_alloc<block>> m_blocks;
+    size_t m_used = 0;
+    allocator_type m_alloc;
+};
+
+/**
+ * Common part of pool based maps: entries are stored contiguously, keys are views into a string pool
+ */
+template <typename S, typename V, typename Allocator>
+class pooled_map_base
+{
+public:
+    using char_type = typename S::value_type;
+    using traits_type = typename S::traits_type;
+    using key_type = std::basic_string_view<char_type, traits_type>;
+    using mapped_type = V;
+    using value_type = std::pair<key_type, mapped_type>;
+    using allocator_type = Allocator;
+    using container_type = std::vector<value_type, typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>>;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using size_type = size_t;
+
+    explicit pooled_map_base(const allocator_type& alloc = allocator_type())
+        : m_entries(typename container_type::allocator_type(alloc)), m_pool(alloc), m_alloc(alloc) {}
+
+    pooled_map_base(const pooled_map_base& other)
+        : pooled_map_base(other, std::allocator_traits<Allocator>::select_on_container_copy_construction(other.m_alloc)) {}
+
+    pooled_map_base(pooled_map_base&&) noexcept = default;
+
+    pooled_map_base(const pooled_map_base& other, const allocator_type& alloc)
+        : m_entries(other.m_entries, typename container_type::allocator_type(alloc)), m_pool(alloc), m_alloc(alloc)
+    {
+        for(value_type& entry: m_entries)
+            entry.first = m_pool.intern(entry.first);
+    }
+
+    //! Steal memory of other if allocators are equal, otherwise move values and copy keys
+    pooled_map_base(pooled_map_base&& other, const allocator_type& alloc)
+        : m_entries(typename container_type::allocator_type(alloc)), m_pool(alloc), m_alloc(alloc)
+    {
+        if(m_alloc == other.m_alloc)
+        {
+            m_entries = std::move(other.m_entries);
+            m_pool = std::move(other.m_pool);
+            return;
+        }
+        m_entries.reserve(other.m_entries.size());
+        for(value_type& entry: other.m_entries)
+            m_entries.emplace_back(m_pool.intern(entry.first), std::move(entry.second));
+    }
+
+    pooled_map_base& operator=(const pooled_map_base& other)
+    {
+        if(this != &other)
+        {
+            pooled_map_base copy(other, m_alloc);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    //! Allocator is kept, entries are moved to it if it differs from the allocator of other
+    pooled_map_base& operator=(pooled_map_base&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value)
+    {
+        if(this == &other)
+            return *this;
+        if(m_alloc == other.m_alloc)
+        {
+            m_entries = std::move(other.m_entries);
+            m_pool = std::move(other.m_pool);
+            return *this;
+        }
+        clear_entries();
+        m_entries.reserve(other.m_entries.size());
+        for(value_type& entry: other.m_entries)
+            m_entries.emplace_back(m_pool.intern(entry.first), std::move(entry.second));
+        return *this;
+    }
+
+    allocator_type get_allocator() const { return m_alloc; }
+
+    iterator begin() noexcept { return m_entries.begin(); }
+    const_iterator begin() const noexcept { return m_entries.begin(); }
+    iterator end() noexcept { return m_entries.end(); }
+    const_iterator end() const noexcept { return m_entries.end(); }
+
+    size_type size() const noexcept { return m_entries.size(); }
+    bool empty() const noexcept { return m_entries.empty(); }
+
+    //! Bytes used by entries and keys, not counting memory owned by mapped values
+    size_t memory_usage() const noexcept
+    {
+        return m_entries.capacity() * sizeof(value_type) + m_pool.capacity() * sizeof(char_type);
+    }
+
+protected:
+    //! Entry with key copied into the pool, allocator aware values get the allocator of the map
+    template <typename KeyTuple, typename MappedTuple>
+    value_type make_entry(KeyTuple&& key, MappedTuple&& mapped)
+    {
+        if constexpr(std::uses_allocator<mapped_type, Allocator>::value)
+            return value_type(m_pool.intern(key_type(std::get<0>(key))), std::make_from_tuple<mapped_type>(
+                    std::tuple_cat(std::forward<MappedTuple>(mapped), std::forward_as_tuple(m_alloc))));
+        else
+            return value_type(m_pool.intern(key_type(std::get<0>(key))),
+                              std::make_from_tuple<mapped_type>(std::forward<MappedTuple>(mapped)));
+    }
+
+    void clear_entries() noexcept
+    {
+        m_entries.clear();
+        m_pool.clear();
+    }
+
+    container_type m_entries;
+    string_pool<char_type, traits_type, Allocator> m_pool;
+    allocator_type m_alloc;
+};
+
+/**
+ * Map keeping entries in a sorted vector
+ * First characters of every key after the prefix common to all keys are kept in a separate dense array,
+ * so binary search touches the string pool only when they are equal. Insertion is linear.
+ */
+template <typename S, typename V, typename Allocator>
+class flat_map : public pooled_map_base<S, V, Allocator>
+{
+    using base_type = pooled_map_base<S, V, Allocator>;
+public:
+    using typename base_type::key_type;
+    using typename base_type::mapped_type;
+    using typename base_type::value_type;
+    using typename base_type::iterator;
+    using typename base_type::const_iterator;
+    using typename base_type::allocator_type;
+
+    explicit flat_map(const allocator_type& alloc = allocator_type())
+        : base_type(alloc), m_prefixes(prefix_allocator(alloc)) {}
+
+    flat_map(const flat_map&) = default;
+    flat_map(flat_map&&) = default;
+    flat_map& operator=(const flat_map&) = default;
+    flat_map& operator=(flat_map&&) = default;
+
+    flat_map(const flat_map& other, const allocator_type& alloc)
+        : base_type(other, alloc), m_prefixes(other.m_prefixes, prefix_allocator(alloc)), m_skip(other.m_skip) {}
+
+    flat_map(flat_map&& other, const allocator_type& alloc)
+        : base_type(std::move(other), alloc), m_prefixes(std::move(other.m_prefixes), prefix_allocator(alloc)),
+          m_skip(other.m_skip) {}
+
+    iterator find(key_type key)
+    {
+        auto it = lower_bound(key);
+        return it != this->m_entries.end() && it->first == key ? it : this->m_entries.end();
+    }
+
+    const_iterator find(key_type key) const
+    {
+        return const_cast<flat_map*>(this)->find(key);
+    }
+
+    mapped_type& at(key_type key)
+    {
+        auto it = find(key);
+        if(it == this->end())
+            throw std::out_of_range("flat_map::at");
+        return it->second;
+    }
+
+    const mapped_type& at(key_type key) const
+    {
+        return const_cast<flat_map*>(this)->at(key);
+    }
+
+    void clear() noexcept
+    {
+        this->clear_entries();
+        m_prefixes.clear();
+        m_skip = 0;
+    }
+
+    template <typename KeyTuple, typename MappedTuple>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, KeyTuple&& key, MappedTuple&& mapped)
+    {
+        const key_type key_view(std::get<0>(key));
+        auto it = lower_bound(key_view);
+        if(it != this->m_entries.end() && it->first == key_view)
+            return {it, false};
+        const size_t pos = it - this->m_entries.begin();
+        it = this->m_entries.insert(it, this->make_entry(std::forward<KeyTuple>(key), std::forward<MappedTuple>(mapped)));
+        m_prefixes.insert(m_prefixes.begin() + pos, 0);
+        update_prefixes(pos, it->first);
+        return {it, true};
+    }
+
+    //! Bytes used by entries, keys and prefixes, not counting memory owned by mapped values
+    size_t memory_usage() const noexcept
+    {
+        return base_type::memory_usage() + m_prefixes.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    using char_type = typename base_type::char_type;
+    using prefix_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<uint64_t>;
+
+    //! First characters packed into integer which order is consistent with the order of keys
+    static uint64_t prefix(key_type key) noexcept
+    {
+        if(!std::is_same<typename base_type::traits_type, std::char_traits<char_type>>::value)
+            return 0;
+        constexpr size_t bits = sizeof(char_type) * 8;
+        constexpr size_t count = sizeof(uint64_t) / sizeof(char_type);
+        uint64_t res = 0;
+        for(size_t i = 0; i < count; ++i)
+        {
+            res <<= bits;
+            if(i < key.size())
+                res |= static_cast<std::make_unsigned_t<char_type>>(key[i]);
+        }
+        return res;
+    }
+
+    //! Update common prefix length and prefix of inserted key at pos
+    void update_prefixes(size_t pos, key_type key)
+    {
+        const auto& entries = this->m_entries;
+        const size_t skip = entries.size() == 1 ? key.size() : common_length(key, pos == 0 ? entries[1].first : entries[0].first);
+        if(skip == m_skip)
+        {
+            m_prefixes[pos] = prefix(key.substr(m_skip));
+            return;
+        }
+        m_skip = skip;
+        for(size_t i = 0; i < entries.size(); ++i)
+            m_prefixes[i] = prefix(entries[i].first.substr(m_skip));
+    }
+
+    size_t common_length(key_type key, key_type other) const noexcept
+    {
+        size_t res = 0;
+        const size_t max = std::min({key.size(), other.size(), m_skip});
+        while(res != max && key[res] == other[res])
+            ++res;
+        return res;
+    }
+
+    iterator lower_bound(key_type key)
+    {
+        auto& entries = this->m_entries;
+        // sorted input is common, check the tail before searching
+        if(entries.empty() || entries.back().first < key)
+            return entries.end();
+
+        const int cmp = key.substr(0, m_skip).compare(entries.front().first.substr(0, m_skip));
+        if(cmp != 0)
+            return cmp < 0 ? entries.begin() : entries.end();
+
+        const uint64_t key_prefix = prefix(key.substr(m_skip));
+        auto first = std::lower_bound(m_prefixes.begin(), m_prefixes.end(), key_prefix);
+        auto last = std::upper_bound(first, m_prefixes.end(), key_prefix);
+        return std::lower_bound(entries.begin() + (first - m_prefixes.begin()),
+                                entries.begin() + (last - m_prefixes.begin()), key,
+                                [](const value_type& entry, key_type k) { return entry.first < k; });
+    }
+
+    std::vector<uint64_t, prefix_allocator> m_prefixes;
+    size_t m_skip = 0;  //!< length of prefix common to all keys
+};
+
+/**
+ * Map keeping entries in insertion order with open addressing hash index
+ */
+template <typename S, typename V, typename Allocator>
+class hash_map : public pooled_map_base<S, V, Allocator>
+{
+    using base_type = pooled_map_base<S, V, Allocator>;
+public:
+    using typename base_type::key_type;
+    using typename base_type::mapped_type;
+    using typename base_type::value_type;
+    using typename base_type::iterator;
+    using typename base_type::const_iterator;
+    using typename base_type::allocator_type;
+
+    explicit hash_map(const allocator_type& alloc = allocator_type())
+        : base_type(alloc), m_slots(slot_allocator(alloc)) {}
+
+    hash_map(const hash_map&) = default;
+    hash_map(hash_map&&) = default;
+    hash_map& operator=(const hash_map&) = default;
+    hash_map& operator=(hash_map&&) = default;
+
+    hash_map(const hash_map& other, const allocator_type& alloc)
+        : base_type(other, alloc), m_slots(other.m_slots, slot_allocator(alloc)) {}
+
+    //! Slots keep entry indices, so they stay valid when entries are moved to the new allocator
+    hash_map(hash_map&& other, const allocator_type& alloc)
+        : base_type(std::move(other), alloc), m_slots(std::move(other.m_slots), slot_allocator(alloc)) {}
+
+    iterator find(key_type key)
+    {
+        return find(key, hash_string(key));
+    }
+
+    const_iterator find(key_type key) const
+    {
+        return const_cast<hash_map*>(this)->find(key);
+    }
+
+    //! Find key which hash_string() is already known
+    iterator find(key_type key, uint64_t hash)
+    {
+        const size_t pos = find_slot(key, hash);
+        if(m_slots.empty() || m_slots[pos].index == 0)
+            return this->m_entries.end();
+        return this->m_entries.begin() + (m_slots[pos].index - 1);
+    }
+
+    const_iterator find(key_type key, uint64_t hash) const
+    {
+        return const_cast<hash_map*>(this)->find(key, hash);
+    }
+
+    mapped_type& at(key_type key)
+    {
+        auto it = find(key);
+        if(it == this->end())
+            throw std::out_of_range("hash_map::at");
+        return it->second;
+    }
+
+    const mapped_type& at(key_type key) const
+    {
+        return const_cast<hash_map*>(this)->at(key);
+    }
+
+    void clear() noexcept
+    {
+        this->clear_entries();
+        m_slots.clear();
+    }
+
+    template <typename KeyTuple, typename MappedTuple>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, KeyTuple&& key, MappedTuple&& mapped)
+    {
+        if((this->m_entries.size() + 1) * 2 > m_slots.size())
+            rehash(std::max<size_t>(16, m_slots.size() * 2));
+
+        const key_type key_view(std::get<0>(key));
+        const uint64_t hash = hash_string(key_view);
+        const size_t pos = find_slot(key_view, hash);
+        if(m_slots[pos].index != 0)
+            return {this->m_entries.begin() + (m_slots[pos].index - 1), false};
+
+        this->m_entries.push_back(this->make_entry(std::forward<KeyTuple>(key), std::forward<MappedTuple>(mapped)));
+        m_slots[pos] = slot{static_cast<uint32_t>(hash), static_cast<uint32_t>(this->m_entries.size())};
+        return {this->m_entries.end() - 1, true};
+    }
+
+    //! Bytes used by entries, keys and hash index, not counting memory owned by mapped values
+    size_t memory_usage() const noexcept
+    {
+        return base_type::memory_usage() + m_slots.capacity() * sizeof(slot);
+    }
+
+private:
+    struct slot
+    {
+        uint32_t hash;
+        uint32_t index;     //!< entry index + 1, 0 for empty slot
+    };
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+
+    //! Position of the slot containing key or of the empty slot where it should be placed
+    size_t find_slot(key_type key, uint64_t hash) const noexcept
+    {
+        if(m_slots.empty())
+            return 0;
+        const size_t mask = m_slots.size() - 1;
+        for(size_t pos = hash & mask;; pos = (pos + 1) & mask)
+        {
+            const slot& s = m_slots[pos];
+            if(s.index == 0 || (s.hash == static_cast<uint32_t>(hash) && this->m_entries[s.index - 1].first == key))
+                return pos;
+        }
+    }
+
+    void rehash(size_t size)
+    {
+        std::vector<slot, slot_allocator> slots(size, slot{0, 0}, m_slots.get_allocator());
+        const size_t mask = size - 1;
+        for(const slot& s: m_slots)
+        {
+            if(s.index == 0)
+                continue;
+            const uint64_t hash = hash_string(this->m_entries[s.index - 1].first);
+            size_t pos = hash & mask;
+            while(slots[pos].index != 0)
+                pos = (pos + 1) & mask;
+            slots[pos] = slot{static_cast<uint32_t>(hash), s.index};
+        }
+        m_slots = std::move(slots);
+    }
+
+    std::vector<slot, slot_allocator> m_slots;
+};
+
+}
+
+/**
+ * Storage policy keeping sections and values in std::map
+ * Comparator is transparent, so views are looked up without copying them into keys
+ */
+struct ordered_storage
+{
+    //! Iteration order is the order of keys
+    static constexpr bool sorted = true;
+
+    template <typename S, typename V, typename Allocator>
+    using container = std::map<S, V, std::less<>,
+                               typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const S, V>>>;
+};
+
+/**
+ * Storage policy keeping sections and values in a sorted vector with keys packed into a string pool
+ * Best suited for files which are loaded once and read many times
+ */
+struct flat_storage
+{
+    //! Iteration order is the order of keys
+    static constexpr bool sorted = true;
+
+    template <typename S, typename V, typename Allocator>
+    using container = details::flat_map<S, V, Allocator>;
+};
+
+/**
+ * Storage policy keeping sections and values in an open addressing hash table with keys packed into a string pool
+ * Iteration order is the order of definition in the file
+ */
+struct hash_storage
+{
+    //! Iteration order is the order of definition
+    static constexpr bool sorted = false;
+
+    template <typename S, typename V, typename Allocator>
+    using container = details::hash_map<S, V, Allocator>;
+};
+
+}
+
+#endif //INI_STORAGE_H
@@ -2,10 +2,19 @@
 #define INI_PARSER_VALUE_H
 
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <charconv>
+#include <cstring>
+#include <array>
+#include <iterator>
+#include <algorithm>
 #include <regex>
 #include "errors.h"
 #include "synax.h"
+#include "lexer.h"
+#include "cache.h"
+#include "stats.h"
 
 namespace ini
 {
@@ -34,6 +43,7 @@ class BasicValue<std::basic_string<CharT, Traits, Allocator>>
 {
 public:
     using string_type = std::basic_string<CharT, Traits, Allocator>;
+    using allocator_type = Allocator;
     /**
      * @brief Default constructor
      * @attention will contain an empty value only
@@ -50,6 +60,19 @@ public:
      */
     inline explicit BasicValue(string_type&& str);
 
+    BasicValue(const BasicValue&) = default;
+    BasicValue(BasicValue&&) = default;
+    BasicValue& operator=(const BasicValue&) = default;
+    BasicValue& operator=(BasicValue&&) = default;
+
+    /**
+     * Uses-allocator constructors, the string is placed into memory of alloc
+     */
+    inline BasicValue(const string_type& str, const Allocator& alloc);
+    inline BasicValue(string_type&& str, const Allocator& alloc);
+    inline BasicValue(const BasicValue& other, const Allocator& alloc);
+    inline BasicValue(BasicValue&& other, const Allocator& alloc);
+
     /**
      * @brief Convert to type
      * @tparam T type to convert to
@@ -70,8 +93,33 @@ public:
     template <typename T>
     T as(const T& default_value) const;
 
+    /**
+     * @brief Convert to type once and keep the result
+     * Next calls with the same T return the kept result, concurrent calls are safe
+     * @tparam T type to convert to
+     * @return reference to the result valid until the value is assigned or destroyed
+     * @throw ini::not_convertible if convert wasn't success, failures are not kept
+     * @throw std::invalid_argument if value strung was empty and T is not default constructible
+     */
+    template <typename T>
+    const T& as_cached() const;
+
+    /**
+     * @brief Convert array value into caller provided buffer without allocation
+     * @tparam T type of elements
+     * @param buffer pointer to the first element of the buffer
+     * @param capacity number of elements in the buffer
+     * @return number of converted elements, 0 if value is empty
+     * @throw ini::not_convertible if value is not an array, an element couldn't be converted
+     * or there are more elements than capacity
+     */
+    template <typename T>
+    size_t as_array(T* buffer, size_t capacity) const;
+
     //! Returns true if value is empty
     inline bool empty() const { return m_str_value.empty(); }
+    //! Returns held string as it was read from file
+    std::basic_string_view<CharT, Traits> view() const noexcept { return m_str_value; }
 private:
     template <typename T>
     static T get_default(std::true_type) { return T(); }
@@ -80,11 +128,95 @@ private:
     static T get_default(std::false_type) { throw std::invalid_argument("No default value!"); }
 
     string_type m_str_value;
+    details::conversion_cache m_cache;
 };
 
 typedef BasicValue<std::string> Value;
 typedef BasicValue<std::wstring> wValue;
 
+/**
+ * Value class referencing a string owned by someone else
+ * @attention referenced string must outlive the value
+ */
+template <typename CharT, typename Traits>
+class BasicValue<std::basic_string_view<CharT, Traits>>
+{
+public:
+    using string_type = std::basic_string_view<CharT, Traits>;
+    /**
+     * @brief Default constructor
+     * @attention will contain an empty value only
+     */
+    BasicValue() noexcept = default;
+    /**
+     * @brief View constructor
+     * @param str view of a string containing a value
+     */
+    explicit BasicValue(string_type str) noexcept : m_str_value(str) {}
+
+    /**
+     * @brief Convert to type
+     * Strings and fundamental types are converted directly from the view,
+     * other types get a temporary std::basic_string to be passed to their from_string
+     * @tparam T type to convert to
+     * @return value of type T containing in value string or T() if string was empty
+     * @throw ini::not_convertible if convert wasn't success
+     * @throw std::invalid_argument if value strung was empty and T is not default constructible
+     */
+    template <typename T>
+    T as() const;
+
+    /**
+     * @brief Convert to type
+     * @tparam T type to convert to
+     * @param default_value value to return if value string is empty
+     * @return value of type T containing in value string or default_value if string was empty
+     * @throw ini::not_convertible if convert wasn't success
+     */
+    template <typename T>
+    T as(const T& default_value) const;
+
+    /**
+     * @brief Convert to type once and keep the result
+     * Next calls with the same T return the kept result, concurrent calls are safe
+     * @tparam T type to convert to
+     * @return reference to the result valid until the value is assigned or destroyed
+     * @throw ini::not_convertible if convert wasn't success, failures are not kept
+     * @throw std::invalid_argument if value strung was empty and T is not default constructible
+     */
+    template <typename T>
+    const T& as_cached() const;
+
+    /**
+     * @brief Convert array value into caller provided buffer without allocation
+     * @tparam T type of elements
+     * @param buffer pointer to the first element of the buffer
+     * @param capacity number of elements in the buffer
+     * @return number of converted elements, 0 if value is empty
+     * @throw ini::not_convertible if value is not an array, an element couldn't be converted
+     * or there are more elements than capacity
+     */
+    template <typename T>
+    size_t as_array(T* buffer, size_t capacity) const;
+
+    //! Returns true if value is empty
+    bool empty() const noexcept { return m_str_value.empty(); }
+    //! Returns referenced string
+    string_type view() const noexcept { return m_str_value; }
+private:
+    template <typename T>
+    static T get_default(std::true_type) { return T(); }
+
+    template <typename T>
+    static T get_default(std::false_type) { throw std::invalid_argument("No default value!"); }
+
+    string_type m_str_value;
+    details::conversion_cache m_cache;
+};
+
+typedef BasicValue<std::string_view> ViewValue;
+typedef BasicValue<std::wstring_view> wViewValue;
+
 /**
  * Customization namespace
  * Use to define from string converts of types you haven't got access to
@@ -166,24 +298,77 @@ struct stringer {};
 namespace details
 {
 
+/**
+ * Non-owning read-only stream buffer over a string view
+ */
+template <typename CharT, typename Traits>
+class view_streambuf : public std::basic_streambuf<CharT, Traits>
+{
+public:
+    explicit view_streambuf(std::basic_string_view<CharT, Traits> str)
+    {
+        CharT* data = const_cast<CharT*>(str.data());
+        this->setg(data, data, data + str.size());
+    }
+};
+
+/**
+ * @brief Text of a string value without surrounding spaces and quotes
+ * Equal to value_traits comma_regex and spaces_regex matches, but runs in linear time without recursion
+ * @return empty view if value is neither a quoted string nor a single line
+ */
+template <typename CharT, typename Traits>
+std::basic_string_view<CharT, Traits> string_content(std::basic_string_view<CharT, Traits> str)
+{
+    using cc = syntax::details::char_class<CharT>;
+
+    const CharT* first = syntax::details::skip_spaces(str.data(), str.data() + str.size());
+    const CharT* last = str.data() + str.size();
+    while(last != first && cc::is_space(last[-1]))
+        --last;
+    if(first == last)
+        return {};
+
+    // quoted string: every quote inside must be escaped with backslash
+    if(last - first >= 2 && *first == CharT('"') && last[-1] == CharT('"'))
+    {
+        bool escaped = true;
+        for(const CharT* it = first + 1; it != last - 1 && escaped; ++it)
+            escaped = *it != CharT('"') || it[-1] == CharT('\\');
+        if(escaped)
+            return std::basic_string_view<CharT, Traits>(first + 1, last - first - 2);
+    }
+
+    if(syntax::details::has_line_terminator(first, last))
+        return {};
+    return std::basic_string_view<CharT, Traits>(first, last - first);
+}
+
 template <typename CharT, typename Traits, typename Allocator>
 typename std::basic_string<CharT, Traits, Allocator> from_string(
         tag_t<std::basic_string<CharT, Traits, Allocator>>,
-        const std::basic_string<CharT, Traits, Allocator>& str)
+        std::basic_string_view<CharT, Traits> str)
 {
     using string_type = std::basic_string<CharT, Traits, Allocator>;
 
-    std::match_results<typename string_type::const_iterator, Allocator> match;
     string_type res;
-    if(!std::regex_match(str, match, syntax::value_traits<CharT>::comma_regex()))
-        std::regex_match(str, match, syntax::value_traits<CharT>::spaces_regex());
-    res = match[1].str();
+    auto content = string_content(str);
+    res.assign(content.data(), content.size());
 
     auto slash_end = std::remove(res.begin(), res.end(), '\\');
     res.erase(slash_end, res.end());
     return res;
 }
 
+//! Value and result may use different allocators, e.g. std::string from a value of std::pmr::string
+template <typename CharT, typename Traits, typename Allocator, typename StringAllocator>
+typename std::basic_string<CharT, Traits, Allocator> from_string(
+        tag_t<std::basic_string<CharT, Traits, Allocator>> tag,
+        const std::basic_string<CharT, Traits, StringAllocator>& str)
+{
+    return from_string(tag, std::basic_string_view<CharT, Traits>(str));
+}
+
 template <typename CharT, typename Traits, typename Allocator>
 BasicValue<std::basic_string<CharT, Traits, Allocator>> from_string(tag_t<BasicValue<std::basic_string<CharT, Traits, Allocator>>>,
                                                  const std::basic_string<CharT, Traits, Allocator>& str) noexcept
@@ -191,28 +376,139 @@ BasicValue<std::basic_string<CharT, Traits, Allocator>> from_string(tag_t<BasicV
     return BasicValue<std::basic_string<CharT, Traits, Allocator>>(str);
 }
 
-template <typename CharT, typename Traits, typename Allocator, typename T>
-std::enable_if_t<std::is_fundamental<T>::value, T> from_string(tag_t<T>,
-        const std::basic_string<CharT, Traits, Allocator>& str)
+template <typename T>
+struct is_character : std::integral_constant<bool,
+        std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value ||
+        std::is_same<T, wchar_t>::value || std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value> {};
+
+//! Returns true if sequence starts with word which is not followed by a letter, a digit or '_'
+inline bool starts_with_word(const char* first, const char* last, std::string_view word) noexcept
+{
+    if(static_cast<size_t>(last - first) < word.size() || std::memcmp(first, word.data(), word.size()) != 0)
+        return false;
+    if(first + word.size() == last)
+        return true;
+    const char next = first[word.size()];
+    return !(next >= 'a' && next <= 'z') && !(next >= 'A' && next <= 'Z') && !(next >= '0' && next <= '9') && next != '_';
+}
+
+/**
+ * Locale independent conversion of a number at the beginning of a character sequence
+ * Follows std::istream rules: '+' sign is allowed, trailing characters are ignored, floating point numbers
+ * start with a digit or '.', so inf and nan are not numbers, and bool is read as 0 or 1.
+ * Differences from std::istream: bool is additionally read as the words true or false,
+ * and a negative number is out of range of an unsigned T instead of being wrapped around.
+ * @return false if there is no number or it is out of range of T
+ */
+template <typename T>
+bool parse_number(const char* first, const char* last, T& res) noexcept
+{
+    if(first != last && *first == '+')
+    {
+        ++first;
+        if(first != last && *first == '-')
+            return false;
+    }
+
+    if constexpr (std::is_same<T, bool>::value)
+    {
+        if(starts_with_word(first, last, "true"))
+        {
+            res = true;
+            return true;
+        }
+        if(starts_with_word(first, last, "false"))
+        {
+            res = false;
+            return true;
+        }
+        long value = 0;
+        if(std::from_chars(first, last, value).ec != std::errc() || (value != 0 && value != 1))
+            return false;
+        res = value != 0;
+        return true;
+    }
+    else if constexpr (std::is_integral<T>::value)
+        return std::from_chars(first, last, res).ec == std::errc();
+    else
+    {
+        const char* digits = first != last && *first == '-' ? first + 1 : first;
+        if(digits == last || (*digits != '.' && (*digits < '0' || *digits > '9')))
+            return false;
+        return std::from_chars(first, last, res, std::chars_format::general).ec == std::errc();
+    }
+}
+
+/**
+ * Conversion through std::basic_istream without allocations
+ */
+template <typename T, typename CharT, typename Traits>
+T stream_from_string(std::basic_string_view<CharT, Traits> str)
 {
-    std::basic_istringstream<CharT, Traits, Allocator> iss(str);
+    view_streambuf<CharT, Traits> buf(str);
+    std::basic_istream<CharT, Traits> is(&buf);
     T res;
-    iss >> res;
-    if(iss.fail())
+    is >> res;
+    if(is.fail())
         throw not_convertible();
     return res;
 }
 
+template <typename CharT, typename Traits, typename T>
+std::enable_if_t<std::is_fundamental<T>::value, T> from_string(tag_t<T>,
+        std::basic_string_view<CharT, Traits> str)
+{
+    using char_class = syntax::details::char_class<CharT>;
+
+    const CharT* first = str.data();
+    const CharT* last = first + str.size();
+    while(first != last && char_class::is_space(*first))
+        ++first;
+
+    if constexpr (is_character<T>::value)
+    {
+        if(first == last)
+            throw not_convertible();
+        return static_cast<T>(*first);
+    }
+    else
+    {
+        T res;
+        if constexpr (sizeof(CharT) == 1)
+        {
+            if(!parse_number(reinterpret_cast<const char*>(first), reinterpret_cast<const char*>(last), res))
+                throw not_convertible();
+        }
+        else
+        {
+            // numbers consist of ASCII characters only, copy them to narrow buffer
+            constexpr size_t buffer_size = 128;
+            char buffer[buffer_size];
+            size_t size = 0;
+            for(; first != last && size != buffer_size && char_class::is_ascii(*first); ++first)
+                buffer[size++] = static_cast<char>(*first);
+            if(size == buffer_size)
+                return stream_from_string<T>(str);
+            if(!parse_number(buffer, buffer + size, res))
+                throw not_convertible();
+        }
+        return res;
+    }
+}
+
+template <typename CharT, typename Traits, typename Allocator, typename T>
+std::enable_if_t<std::is_fundamental<T>::value, T> from_string(tag_t<T> tag,
+        const std::basic_string<CharT, Traits, Allocator>& str)
+{
+    return from_string(tag, std::basic_string_view<CharT, Traits>(str));
+}
+
 template <typename CharT, typename Traits, typename Allocator, typename T,
         typename = decltype(operator>>(std::declval<std::basic_istream<CharT, Traits>&>(), std::declval<T&>()))>
-auto from_string(tag_t<T>, const std::basic_string<CharT, Traits, Allocator>& str) -> decltype(T())
+auto from_string(tag_t<T>, const std::basic_string<CharT, Traits, Allocator>& str)
+    -> std::enable_if_t<!std::is_fundamental<T>::value, decltype(T())>
 {
-    std::basic_istringstream<CharT, Traits, Allocator> iss(str);
-    T res;
-    iss >> res;
-    if(iss.fail())
-        throw not_convertible();
-    return res;
+    return stream_from_string<T>(std::basic_string_view<CharT, Traits>(str));
 }
 
 template <typename CharT, typename Traits, typename Allocator, typename T>
@@ -231,28 +527,173 @@ auto from_string(tag_t<T>, const std::basic_string<CharT, Traits, Allocator>& st
     return customization::stringer<T>::_(str);
 }
 
-template <typename CharT, typename Traits, typename Allocator, typename T,
-        typename = decltype(
-                T().push_back(from_string(ini::tag_t<typename T::value_type>(),
-                        std::declval<std::basic_string<CharT, Traits, Allocator>>()))
-                )>
-T from_string(tag_t<T>, const std::basic_string<CharT, Traits, Allocator>& str)
+template <typename T, typename = void>
+struct is_push_back_container : std::false_type {};
+
+template <typename T>
+struct is_push_back_container<T, std::void_t<decltype(std::declval<T&>().push_back(std::declval<typename T::value_type>()))>>
+    : std::true_type {};
+
+template <typename CharT, typename Traits, typename Allocator>
+struct is_push_back_container<std::basic_string<CharT, Traits, Allocator>> : std::false_type {};
+
+template <typename T, typename = void>
+struct has_reserve : std::false_type {};
+
+template <typename T>
+struct has_reserve<T, std::void_t<decltype(std::declval<T&>().reserve(size_t()))>> : std::true_type {};
+
+/**
+ * @brief Split array value into elements in one pass without allocation
+ * Array is '[' element [',' element]... ']', new line separates elements as well as ','.
+ * Separators and ']' inside double quotes are part of an element, '\\' escapes a character inside quotes.
+ * Empty elements are skipped, elements are not trimmed.
+ * @param str array value
+ * @param on_element function called with view of every element
+ * @return number of elements
+ * @throw ini::not_convertible if str is not an array
+ */
+template <typename CharT, typename Traits, typename F>
+size_t split_array(std::basic_string_view<CharT, Traits> str, F&& on_element)
+{
+    if(str.size() < 2 || str.front() != CharT('[') || str.back() != CharT(']'))
+        throw not_convertible();
+
+    const CharT* it = str.data() + 1;
+    const CharT* last = str.data() + str.size() - 1;
+    const CharT* element = it;
+    size_t count = 0;
+    bool quoted = false;
+    for(; it != last; ++it)
+    {
+        const CharT c = *it;
+        if(quoted)
+        {
+            if(c == CharT('\\') && it + 1 != last)
+                ++it;
+            else if(c == CharT('"'))
+                quoted = false;
+        }
+        else if(c == CharT('"'))
+            quoted = true;
+        else if(c == CharT(',') || c == CharT('\n'))
+        {
+            if(it != element)
+            {
+                on_element(std::basic_string_view<CharT, Traits>(element, it - element));
+                ++count;
+            }
+            element = it + 1;
+        }
+        else if(c == CharT(']'))
+            throw not_convertible();
+    }
+    if(it != element)
+    {
+        on_element(std::basic_string_view<CharT, Traits>(element, it - element));
+        ++count;
+    }
+    return count;
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+BasicValue<std::basic_string<CharT, Traits, Allocator>> from_string(tag_t<BasicValue<std::basic_string<CharT, Traits, Allocator>>>,
+                                                                     std::basic_string_view<CharT, Traits> str)
+{
+    return BasicValue<std::basic_string<CharT, Traits, Allocator>>(std::basic_string<CharT, Traits, Allocator>(str));
+}
+
+template <typename CharT, typename Traits>
+BasicValue<std::basic_string_view<CharT, Traits>> from_string(tag_t<BasicValue<std::basic_string_view<CharT, Traits>>>,
+                                                              std::basic_string_view<CharT, Traits> str) noexcept
+{
+    return BasicValue<std::basic_string_view<CharT, Traits>>(str);
+}
+
+template <typename CharT, typename Traits, typename T>
+std::enable_if_t<is_push_back_container<T>::value, T> from_string(tag_t<T>, std::basic_string_view<CharT, Traits> str);
+
+template <typename CharT, typename Traits, typename T, size_t N>
+std::array<T, N> from_string(tag_t<std::array<T, N>>, std::basic_string_view<CharT, Traits> str);
+
+template <typename CharT, typename Traits, typename Allocator, typename T>
+std::enable_if_t<is_push_back_container<T>::value, T> from_string(tag_t<T> tag,
+        const std::basic_string<CharT, Traits, Allocator>& str)
+{
+    return from_string(tag, std::basic_string_view<CharT, Traits>(str));
+}
+
+template <typename CharT, typename Traits, typename Allocator, typename T, size_t N>
+std::array<T, N> from_string(tag_t<std::array<T, N>> tag, const std::basic_string<CharT, Traits, Allocator>& str)
+{
+    return from_string(tag, std::basic_string_view<CharT, Traits>(str));
+}
+
+/**
+ * Convert view using overload for views if there is one, otherwise through a temporary string
+ */
+template <typename T, typename CharT, typename Traits>
+auto from_view(tag_t<T>, std::basic_string_view<CharT, Traits> str, int)
+    -> decltype(from_string(tag_t<T>(), str))
+{
+    return from_string(tag_t<T>(), str);
+}
+
+template <typename T, typename CharT, typename Traits>
+T from_view(tag_t<T>, std::basic_string_view<CharT, Traits> str, long)
+{
+    return from_string(tag_t<T>(), std::basic_string<CharT, Traits>(str));
+}
+
+template <typename CharT, typename Traits, typename T>
+std::enable_if_t<is_push_back_container<T>::value, T> from_string(tag_t<T>, std::basic_string_view<CharT, Traits> str)
 {
     using value_t = typename T::value_type;
-    using string_type = std::basic_string<CharT, Traits, Allocator>;
 
-    std::match_results<typename string_type::const_iterator, Allocator> match;
-    if(!std::regex_match(str, match, syntax::value_traits<CharT>::array_regex()))
-        throw not_convertible();
-    std::basic_istringstream<CharT, Traits, Allocator> iss(match[1].str());
-    iss.imbue(std::locale(iss.getloc(), syntax::value_traits<CharT>::array_ctype()));
     T res;
-    std::transform(std::istream_iterator<string_type, CharT, Traits>(iss),
-                   std::istream_iterator<string_type, CharT, Traits>(),
-                   std::back_inserter(res), [](const string_type& str) { return from_string(tag_t<value_t>(), str); });
+    if constexpr (has_reserve<T>::value)
+        res.reserve(split_array(str, [](std::basic_string_view<CharT, Traits>) {}));
+    split_array(str, [&res](std::basic_string_view<CharT, Traits> element)
+    {
+        res.push_back(from_view(tag_t<value_t>(), element, 0));
+    });
+    return res;
+}
+
+template <typename CharT, typename Traits, typename T, size_t N>
+std::array<T, N> from_string(tag_t<std::array<T, N>>, std::basic_string_view<CharT, Traits> str)
+{
+    std::array<T, N> res{};
+    size_t count = 0;
+    split_array(str, [&res, &count](std::basic_string_view<CharT, Traits> element)
+    {
+        if(count == N)
+            throw not_convertible();
+        res[count++] = from_view(tag_t<T>(), element, 0);
+    });
+    if(count != N)
+        throw not_convertible();
     return res;
 }
 
+/**
+ * Convert array elements into buffer
+ * @return number of converted elements
+ * @throw ini::not_convertible if str is not an array, an element is not convertible or buffer is too small
+ */
+template <typename T, typename CharT, typename Traits>
+size_t from_string_into(std::basic_string_view<CharT, Traits> str, T* buffer, size_t capacity)
+{
+    size_t count = 0;
+    split_array(str, [buffer, capacity, &count](std::basic_string_view<CharT, Traits> element)
+    {
+        if(count == capacity)
+            throw not_convertible();
+        buffer[count++] = from_view(tag_t<T>(), element, 0);
+    });
+    return count;
+}
+
 struct from_string_fn
 {
     template <typename CharT, typename Traits, typename Allocator, typename T>
@@ -261,6 +702,12 @@ struct from_string_fn
     {
         return from_string(tag_t<T>(), str);
     }
+
+    template <typename CharT, typename Traits, typename T>
+    T operator()(tag_t<T>, std::basic_string_view<CharT, Traits> str) const
+    {
+        return from_view(tag_t<T>(), str, 0);
+    }
 };
 
 }
@@ -284,13 +731,32 @@ template <typename CharT, typename Traits, typename Allocator>
 BasicValue<std::basic_string<CharT, Traits, Allocator>>::BasicValue(string_type&& str)
         : m_str_value(std::move(str)) {}
 
+template <typename CharT, typename Traits, typename Allocator>
+BasicValue<std::basic_string<CharT, Traits, Allocator>>::BasicValue(const string_type& str, const Allocator& alloc)
+        : m_str_value(str, alloc) {}
+
+template <typename CharT, typename Traits, typename Allocator>
+BasicValue<std::basic_string<CharT, Traits, Allocator>>::BasicValue(string_type&& str, const Allocator& alloc)
+        : m_str_value(std::move(str), alloc) {}
+
+template <typename CharT, typename Traits, typename Allocator>
+BasicValue<std::basic_string<CharT, Traits, Allocator>>::BasicValue(const BasicValue& other, const Allocator& alloc)
+        : m_str_value(other.m_str_value, alloc), m_cache(other.m_cache) {}
+
+template <typename CharT, typename Traits, typename Allocator>
+BasicValue<std::basic_string<CharT, Traits, Allocator>>::BasicValue(BasicValue&& other, const Allocator& alloc)
+        : m_str_value(std::move(other.m_str_value), alloc), m_cache(std::move(other.m_cache)) {}
+
 template <typename CharT, typename Traits, typename Allocator>
 template <typename T>
 T BasicValue<std::basic_string<CharT, Traits, Allocator>>::as(const T& default_value) const
 {
     if(empty())
         return default_value;
-    return from_string(tag_t<T>(), m_str_value);
+    details::conversion_probe<T> probe;
+    T res = from_string(tag_t<T>(), m_str_value);
+    probe.succeeded();
+    return res;
 }
 
 template <typename CharT, typename Traits, typename Allocator>
@@ -299,7 +765,66 @@ T BasicValue<std::basic_string<CharT, Traits, Allocator>>::as() const
 {
     if(empty())
         return get_default<T>(std::is_default_constructible<T>());
-    return from_string(tag_t<T>(), m_str_value);
+    details::conversion_probe<T> probe;
+    T res = from_string(tag_t<T>(), m_str_value);
+    probe.succeeded();
+    return res;
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+template <typename T>
+const T& BasicValue<std::basic_string<CharT, Traits, Allocator>>::as_cached() const
+{
+    return m_cache.template get<T>([this] { return as<T>(); });
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+template <typename T>
+size_t BasicValue<std::basic_string<CharT, Traits, Allocator>>::as_array(T* buffer, size_t capacity) const
+{
+    if(empty())
+        return 0;
+    return details::from_string_into(std::basic_string_view<CharT, Traits>(m_str_value), buffer, capacity);
+}
+
+template <typename CharT, typename Traits>
+template <typename T>
+T BasicValue<std::basic_string_view<CharT, Traits>>::as(const T& default_value) const
+{
+    if(empty())
+        return default_value;
+    details::conversion_probe<T> probe;
+    T res = details::from_view(tag_t<T>(), m_str_value, 0);
+    probe.succeeded();
+    return res;
+}
+
+template <typename CharT, typename Traits>
+template <typename T>
+T BasicValue<std::basic_string_view<CharT, Traits>>::as() const
+{
+    if(empty())
+        return get_default<T>(std::is_default_constructible<T>());
+    details::conversion_probe<T> probe;
+    T res = details::from_view(tag_t<T>(), m_str_value, 0);
+    probe.succeeded();
+    return res;
+}
+
+template <typename CharT, typename Traits>
+template <typename T>
+const T& BasicValue<std::basic_string_view<CharT, Traits>>::as_cached() const
+{
+    return m_cache.template get<T>([this] { return as<T>(); });
+}
+
+template <typename CharT, typename Traits>
+template <typename T>
+size_t BasicValue<std::basic_string_view<CharT, Traits>>::as_array(T* buffer, size_t capacity) const
+{
+    if(empty())
+        return 0;
+    return details::from_string_into(m_str_value, buffer, capacity);
 }
 
 }
@@ -0,0 +1,62 @@
+#ifndef INI_VIEWFILE_H
+#define INI_VIEWFILE_H
+
+#include <string>
+#include <string_view>
+#include "parser.h"
+#include "mapping.h"
+
+namespace ini
+{
+
+class ViewFile;
+
+inline void parse(const std::string& filename, ViewFile& file);
+
+typedef Section<std::string_view> ViewSection;
+
+/**
+ * File which section names, keys and values are views into the memory mapped file
+ * Nothing is copied while loading, the mapping lives as long as the file object
+ */
+class ViewFile : public File<std::string_view>
+{
+public:
+    ViewFile() = default;
+    /**
+     * @brief Map and parse file
+     * @param filename path to the file
+     * @throw std::system_error if file could not be mapped
+     * @throw ini::parsing_error if file contains errors
+     */
+    explicit ViewFile(const std::string& filename) { parse(filename, *this); }
+
+    ViewFile(ViewFile&&) = default;
+    ViewFile& operator=(ViewFile&&) = default;
+
+    friend void parse(const std::string& filename, ViewFile& file);
+
+private:
+    details::mapped_file m_mapping;
+};
+
+inline void parse(const std::string& filename, ViewFile& file)
+{
+    details::mapped_file mapping(filename);
+    const char* data = mapping.data();
+    try
+    {
+        parse(syntax::line_iterator<char>(data, data + mapping.size()), syntax::line_iterator<char>(), file);
+    }
+    catch(...)
+    {
+        // parsed views refer to the mapping which is about to be unmapped
+        file.clear();
+        throw;
+    }
+    file.m_mapping = std::move(mapping);
+}
+
+}
+
+#endif //INI_VIEWFILE_H
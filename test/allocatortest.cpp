@@ -0,0 +1,122 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+#include "parser.h"
+
+namespace
+{
+
+//! Number of calls of global operator new, counted for the whole test module
+std::atomic<size_t> allocations_count{0};
+
+}
+
+void* operator new(size_t size)
+{
+    allocations_count.fetch_add(1, std::memory_order_relaxed);
+    if(void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+
+//! Names and values are longer than the small string buffer, so every string needs memory
+std::string generate()
+{
+    std::string res = "; generated file\n";
+    for(size_t s = 0; s < 20; ++s)
+    {
+        res += "[section_with_a_long_name_" + std::to_string(s) + "]\n";
+        for(size_t k = 0; k < 50; ++k)
+            res += "value_with_a_long_name_" + std::to_string(k) + " = " + std::to_string(s * 1000 + k) +
+                   " ; and a long comment\n";
+        res += "list = [1, 2, 3, \"a long string element\"]\n";
+    }
+    return res;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(AllocatorTestSuit)
+
+    typedef boost::mpl::list<ini::ordered_storage, ini::flat_storage, ini::hash_storage> storage_types;
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(ArenaParseTest, Storage, storage_types)
+    {
+        const std::string text = generate();
+        static char buffer[1 << 20];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+        std::vector<std::string> names;
+        for(size_t k = 0; k < 50; k += 7)
+            names.push_back("value_with_a_long_name_" + std::to_string(k));
+
+        size_t parse_allocations = 0, lookup_allocations = 0, copy_allocations = 0;
+        long sum = 0;
+        {
+            size_t before = allocations_count.load();
+            ini::pmr::File<Storage> file(&arena);
+            ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                       ini::syntax::line_iterator<char>(), file);
+            parse_allocations = allocations_count.load() - before;
+
+            before = allocations_count.load();
+            static constexpr ini::key section_key("section_with_a_long_name_7");
+            for(const std::string& name: names)
+                sum += file.at(section_key).template get<long>(name);
+            lookup_allocations = allocations_count.load() - before;
+
+            // copies into the same resource stay inside the arena
+            before = allocations_count.load();
+            ini::pmr::File<Storage> copy(&arena);
+            copy = file;
+            copy_allocations = allocations_count.load() - before;
+            BOOST_CHECK_EQUAL(copy.size(), 20);
+            BOOST_CHECK_EQUAL(copy.at("section_with_a_long_name_19").template get<long>("value_with_a_long_name_49"), 19049);
+        }
+        BOOST_CHECK_EQUAL(parse_allocations, 0);
+        BOOST_CHECK_EQUAL(lookup_allocations, 0);
+        BOOST_CHECK_EQUAL(copy_allocations, 0);
+        BOOST_CHECK_EQUAL(sum, 8 * 7000 + 7 * (0 + 1 + 2 + 3 + 4 + 5 + 6 + 7));
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(ArenaNestingTest, Storage, storage_types)
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::monotonic_buffer_resource other;
+        const std::string text = "[a_section_with_a_long_name]\nvalue_with_a_long_name = a long value of the section\n";
+
+        ini::pmr::File<Storage> file(&arena);
+        ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                   ini::syntax::line_iterator<char>(), file);
+
+        const auto& section = file.at("a_section_with_a_long_name");
+        BOOST_CHECK(section.get_allocator().resource() == &arena);
+        BOOST_CHECK(section.at("value_with_a_long_name").view() == "a long value of the section");
+
+        ini::pmr::File<Storage> moved(&other);
+        moved = std::move(file);
+        const auto& moved_section = moved.at("a_section_with_a_long_name");
+        BOOST_CHECK(moved_section.get_allocator().resource() == &other);
+        BOOST_CHECK_EQUAL(moved_section.template get<std::string>("value_with_a_long_name"), "a long value of the section");
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,180 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "parser.h"
+#include "encoding.h"
+
+namespace
+{
+
+std::string utf16(const std::u32string& text, bool big_endian)
+{
+    std::string res;
+    const auto put = [&res, big_endian](uint32_t unit)
+    {
+        const char high = char(unit >> 8), low = char(unit & 0xFF);
+        res += big_endian ? high : low;
+        res += big_endian ? low : high;
+    };
+    for(char32_t cp: text)
+    {
+        if(cp < 0x10000)
+            put(cp);
+        else
+        {
+            put(0xD800 + ((cp - 0x10000) >> 10));
+            put(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        }
+    }
+    return res;
+}
+
+std::string utf8(const std::u32string& text)
+{
+    std::string res(text.size() * 4, '\0');
+    char* out = &res[0];
+    for(char32_t cp: text)
+        out = ini::details::put_code_point(out, cp);
+    res.resize(out - res.data());
+    return res;
+}
+
+std::wstring wide(const std::u32string& text)
+{
+    std::wstring res(text.size() * 2, L'\0');
+    wchar_t* out = &res[0];
+    for(char32_t cp: text)
+        out = ini::details::put_code_point(out, cp);
+    res.resize(out - res.data());
+    return res;
+}
+
+//! ASCII runs long enough for the vector paths mixed with characters of all UTF-8 lengths
+std::u32string random_text(std::mt19937& gen, size_t size)
+{
+    const char32_t samples[] = {U'a', U'=', U'\n', U'é', U'ж', U'値', U'￿', U'\U0001F600', U'\U0010FFFF'};
+    std::u32string res;
+    while(res.size() < size)
+    {
+        if(gen() % 2)
+            res.append(gen() % 40, char32_t(U'a' + gen() % 26));
+        else
+            res += samples[gen() % (sizeof(samples) / sizeof(samples[0]))];
+    }
+    return res;
+}
+
+void write(const std::string& filename, const std::string& bytes)
+{
+    std::ofstream(filename, std::ios::binary) << bytes;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(EncodingTestSuit)
+
+    BOOST_AUTO_TEST_CASE(DetectEncodingTest)
+    {
+        BOOST_CHECK(ini::detect_encoding("\xEF\xBB\xBF[a]").bom_size == 3);
+        BOOST_CHECK(ini::detect_encoding("\xFF\xFE[\0").type == ini::encoding::utf16le);
+        BOOST_CHECK(ini::detect_encoding("\xFE\xFF\0[").type == ini::encoding::utf16be);
+        BOOST_CHECK(ini::detect_encoding(std::string_view("[\0a\0", 4)).type == ini::encoding::utf16le);
+        BOOST_CHECK(ini::detect_encoding(std::string_view("\0[\0a", 4)).type == ini::encoding::utf16be);
+        BOOST_CHECK(ini::detect_encoding("[a]").type == ini::encoding::utf8);
+        BOOST_CHECK(ini::detect_encoding("").type == ini::encoding::utf8);
+    }
+
+    BOOST_AUTO_TEST_CASE(TranscodingTest)
+    {
+        std::mt19937 gen(3);
+        for(size_t i = 0; i < 300; ++i)
+        {
+            const std::u32string text = random_text(gen, gen() % 200);
+            const std::wstring expected = wide(text);
+            BOOST_REQUIRE(ini::decode<wchar_t>(utf8(text), ini::encoding::utf8) == expected);
+            BOOST_REQUIRE(ini::decode<wchar_t>(utf16(text, false), ini::encoding::utf16le) == expected);
+            BOOST_REQUIRE(ini::decode<wchar_t>(utf16(text, true), ini::encoding::utf16be) == expected);
+            BOOST_REQUIRE(ini::decode<char>(utf16(text, false), ini::encoding::utf16le) == utf8(text));
+            BOOST_REQUIRE(ini::decode<char>(utf16(text, true), ini::encoding::utf16be) == utf8(text));
+        }
+
+        const std::vector<std::string> malformed = {"\x80", "a\xC0\x80", "\xE0\x80\x80", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                                                    "\xF5\x80\x80\x80", "abc\xE2\x82", std::string(20, 'a') + "\xFF"};
+        for(const std::string& bytes: malformed)
+            BOOST_CHECK_THROW(ini::decode<wchar_t>(bytes, ini::encoding::utf8), ini::invalid_encoding);
+        BOOST_CHECK_THROW(ini::decode<wchar_t>(std::string("a\0b", 3), ini::encoding::utf16le), ini::invalid_encoding);
+        BOOST_CHECK_THROW(ini::decode<wchar_t>(utf16(U"abc", false) + std::string("\x00\xD8", 2) + utf16(U"abcdefghijklmnop", false),
+                                               ini::encoding::utf16le), ini::invalid_encoding);
+        BOOST_CHECK_THROW(ini::decode<char>(utf16(U"a", true) + std::string("\xDC\x00", 2), ini::encoding::utf16be),
+                          ini::invalid_encoding);
+        try
+        {
+            ini::decode<wchar_t>(std::string(20, 'a') + "\xFF", ini::encoding::utf8);
+            BOOST_ERROR("malformed UTF-8 is decoded");
+        }
+        catch(const ini::invalid_encoding& e)
+        {
+            BOOST_CHECK_EQUAL(e.offset(), 20);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(EncodedFileTest)
+    {
+        const std::string filename = (std::filesystem::temp_directory_path() / "ini_encoding_test.ini").string();
+        const std::u32string text = U"; конфиг\n"
+                                    U"[section]\n"
+                                    U"name = значение 値 \U0001F600\r\n"
+                                    U"list = [1, 2, \"éé\"]\n"
+                                    U"number = 42\n";
+        const std::vector<std::string> encoded = {utf8(text), "\xEF\xBB\xBF" + utf8(text), "\xFF\xFE" + utf16(text, false),
+                                                  "\xFE\xFF" + utf16(text, true), utf16(text, false), utf16(text, true)};
+        for(const std::string& bytes: encoded)
+        {
+            write(filename, bytes);
+
+            ini::File<std::wstring> wide_file;
+            ini::parse(filename, wide_file);
+            const auto& wide_section = wide_file.at(L"section");
+            BOOST_CHECK(wide_section.at(L"name").as<std::wstring>() == wide(U"значение 値 \U0001F600"));
+            BOOST_CHECK_EQUAL(wide_section.get<int>(L"number"), 42);
+            BOOST_CHECK(wide_section.get<std::vector<std::wstring>>(L"list").back() == L"éé");
+
+            ini::File<std::string> narrow_file;
+            BOOST_CHECK(ini::parse(filename, narrow_file, std::nothrow));
+            const auto& narrow_section = narrow_file.at("section");
+            BOOST_CHECK_EQUAL(narrow_section.at("name").view(), utf8(U"значение 値 \U0001F600"));
+            BOOST_CHECK_EQUAL(narrow_section.get<int>("number"), 42);
+        }
+
+        // offsets of malformed sequences are counted from the beginning of the file, byte order mark included
+        const std::vector<std::pair<std::string, size_t>> broken_files = {
+            {"\xFF\xFE" + utf16(U"[a]\nb = c", false) + std::string("\x00\xDC", 2), 20},
+            {"\xEF\xBB\xBF[a]\nb = \xFF", 11}};
+        for(const auto& broken_file: broken_files)
+        {
+            write(filename, broken_file.first);
+            ini::File<std::wstring> broken;
+            try
+            {
+                ini::parse(filename, broken);
+                BOOST_ERROR("malformed file is parsed");
+            }
+            catch(const ini::invalid_encoding& e)
+            {
+                BOOST_CHECK_EQUAL(e.offset(), broken_file.second);
+            }
+        }
+
+        std::remove(filename.c_str());
+        ini::File<std::string> missing;
+        ini::parse(filename, missing);
+        BOOST_CHECK_EQUAL(missing.size(), 0);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "lexer.h"
+#include "synax.h"
+#include "scan.h"
+
+namespace
+{
+
+template <typename String>
+String token(const String& line, const ini::syntax::token_range& range)
+{
+    return line.substr(range.begin, range.size());
+}
+
+/**
+ * Check lexer against regular expressions from ini_traits in the order parse() used them
+ */
+template <typename String>
+bool same_as_regex(const String& line)
+{
+    using traits = ini::syntax::ini_traits<typename String::value_type>;
+    using ini::syntax::line_type;
+
+    const ini::syntax::line_tokens tokens = ini::syntax::lex_line(line);
+    std::match_results<typename String::const_iterator> match;
+
+    if(line.empty())
+        return tokens.type == line_type::empty;
+    if(std::regex_match(line, traits::comment_line_regex()))
+        return tokens.type == line_type::comment;
+    if(std::regex_match(line, match, traits::section_name_regex()))
+        return tokens.type == line_type::section && token(line, tokens.name) == match[1].str();
+    if(std::regex_match(line, match, traits::value_regex()))
+        return tokens.type == line_type::value &&
+               token(line, tokens.name) == match[1].str() &&
+               token(line, tokens.separator) == match[2].str() &&
+               token(line, tokens.value) == match[3].str() &&
+               token(line, tokens.comment) == match[4].str();
+    return tokens.type == line_type::invalid;
+}
+
+template <typename String>
+void check_random_lines(const String& alphabet, size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> length(0, 24);
+    std::uniform_int_distribution<size_t> symbol(0, alphabet.size() - 1);
+    for(size_t i = 0; i < count; ++i)
+    {
+        String line;
+        for(size_t len = length(gen); len != 0; --len)
+            line.push_back(alphabet[symbol(gen)]);
+        if(!same_as_regex(line))
+            BOOST_ERROR("lexer differs from regex on random line #" << i);
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(LexerTestSuit)
+
+    BOOST_AUTO_TEST_CASE(CornerCasesTest)
+    {
+        const std::vector<std::string> lines = {
+                "", " ", "\r", ";", "  ; comment", "; comment\r", "[a]", " [ a ] ", "[ a_1 ]", "[a]\r", "[]", "[1a]",
+                "[a b]", "a=b", "a = b", "a=bc", "a =bc ; c", "a := b", "a :=b", "a :=bc", "a:=", "a:==", "a = ;",
+                "a = b;", "a = b ;\r", "a = b c   ", "a = \"b; c\"", "a\t:\tb\t", "_a=1", "1a=1", "a b = c", "= b",
+                "a", "a =", "a = [1, 2, 3] ; arr", "a = b\r", "a = b\rc", "a:=:=", "a:= =b"};
+        for(const auto& line: lines)
+            BOOST_CHECK_MESSAGE(same_as_regex(line), "lexer differs from regex on '" << line << "'");
+
+        const std::string line = "  value_2 := 5.25 ; comment";
+        const auto tokens = ini::syntax::lex_line(line);
+        BOOST_REQUIRE(tokens.type == ini::syntax::line_type::value);
+        BOOST_CHECK_EQUAL(token(line, tokens.name), "value_2");
+        BOOST_CHECK_EQUAL(token(line, tokens.separator), ":=");
+        BOOST_CHECK_EQUAL(token(line, tokens.value), "5.25");
+        BOOST_CHECK_EQUAL(token(line, tokens.comment), "; comment");
+    }
+
+    BOOST_AUTO_TEST_CASE(DifferentialTest)
+    {
+        check_random_lines<std::string>(" \t\r\n;[]:=ab_1\".,\xe9", 100000);
+        check_random_lines<std::wstring>(L" \t\r\n;[]:=ab_1\".,\u00e9\u2028\u3000", 100000);
+    }
+
+    BOOST_AUTO_TEST_CASE(LongLineTest)
+    {
+        const std::string line = "key = " + std::string(1 << 20, 'x') + " ; comment";
+        const auto tokens = ini::syntax::lex_line(line);
+        BOOST_REQUIRE(tokens.type == ini::syntax::line_type::value);
+        BOOST_CHECK_EQUAL(tokens.value.size(), size_t(1) << 20);
+    }
+
+    BOOST_AUTO_TEST_CASE(FindBlockTest)
+    {
+        namespace details = ini::syntax::details;
+
+        std::mt19937 gen(7);
+        // single character search over several blocks and a partial one
+        std::string text(5 * ini::syntax::scan_block_size + 17, 'x');
+        for(size_t i = 0; i < 2000; ++i)
+        {
+            std::fill(text.begin(), text.end(), 'x');
+            for(size_t n = gen() % 4; n; --n)
+                text[gen() % text.size()] = ';';
+            const char* first = text.data();
+            const char* last = first + text.size() - gen() % 70;
+            const details::block_match expected = details::find_block_scalar(first, last, ';');
+            const auto same = [&expected](const details::block_match& match)
+            {
+                return match.block == expected.block && match.mask == expected.mask;
+            };
+#ifdef INI_PARSER_SSE2
+            BOOST_REQUIRE(same(details::find_block_sse2(first, last, ';')));
+#endif
+#ifdef INI_PARSER_AVX2
+            if(details::cpu_has_avx2())
+                BOOST_REQUIRE(same(details::find_block_avx2(first, last, ';')));
+#endif
+            const char* found = std::find(first, last, ';');
+            BOOST_REQUIRE_EQUAL(expected.mask ? expected.block + details::count_trailing_zeros(expected.mask) - first : last - first,
+                                found - first);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(NewlineScannerTest)
+    {
+        std::mt19937 gen(11);
+        const std::string alphabet = "\n\n[;=:abcdefghijklmnopqrstuvwxyz    ";
+        for(size_t size: {0, 1, 63, 64, 65, 127, 1000, 4099})
+        {
+            std::string text(size, ' ');
+            for(char& c: text)
+                c = alphabet[gen() % alphabet.size()];
+            // the scanner must not read or report anything past the end
+            const std::string padded = text + "\n;;;\n";
+            const char* first = padded.data();
+            const char* last = first + size;
+
+            ini::syntax::newline_scanner scanner(first, last);
+            for(const char* pos = first; pos <= last; pos += 1 + gen() % 3)
+            {
+                const char* expected = std::find(pos, last, '\n');
+                BOOST_REQUIRE_EQUAL(scanner.find(pos) - first, expected - first);
+            }
+
+            // lines are the same as std::getline gives
+            std::istringstream iss(text);
+            std::vector<std::string> expected;
+            for(std::string line; std::getline(iss, line);)
+                expected.push_back(line);
+            std::vector<std::string> lines;
+            for(ini::syntax::line_iterator<char> it(first, last), end; it != end; ++it)
+                lines.emplace_back(*it);
+            BOOST_CHECK(lines == expected);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,26 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "parser.h"
+#include "viewfile.h"
+#include "parallel.h"
+#include "loader.h"
+#include "interpolate.h"
+#include "lazyfile.h"
+#include "snapshot.h"
+#include "shared.h"
+#include "persistent.h"
+#include "diff.h"
+#include "schema.h"
 #include "teststructures.h"
 
 const std::string test = "[ Section1 ]\n"
@@ -21,6 +41,26 @@ const std::string test = "[ Section1 ]\n"
                          "enum = test_enum::three   \n"
                          "arr : [1, 2, 3, \"string\"]";
 
+struct server_config
+{
+    std::string host = "localhost";
+    int port = 80;
+    double timeout = 0;
+    std::vector<int> retries;
+    bool verbose = false;
+};
+
+constexpr auto server_schema = ini::make_schema(
+        ini::field("server", "host", &server_config::host),
+        ini::required("server", "port", &server_config::port),
+        ini::required("server", "timeout", &server_config::timeout),
+        ini::field("server", "retries", &server_config::retries),
+        ini::field("log", "verbose", &server_config::verbose));
+
+static_assert(server_schema.find("server", "port") == 1, "fields are found at compile time");
+static_assert(server_schema.find("log", "verbose") == 4, "fields are found at compile time");
+static_assert(server_schema.find("log", "port") == server_schema.npos, "section is a part of the key");
+
 BOOST_AUTO_TEST_SUITE(ParserTestSuit)
 
     BOOST_AUTO_TEST_CASE(ParserTest)
@@ -60,5 +100,946 @@ BOOST_AUTO_TEST_SUITE(ParserTestSuit)
         }
     }
 
+    typedef boost::mpl::list<ini::ordered_storage, ini::flat_storage, ini::hash_storage> storage_types;
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(StorageTest, Storage, storage_types)
+    {
+        std::istringstream iss(test);
+        ini::File<std::string, Storage> file;
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), file);
+
+        auto copy = file;
+        file.clear();
+        BOOST_CHECK(file.begin() == file.end());
+
+        const auto& section_1 = copy.at("Section1");
+        BOOST_CHECK_EQUAL(section_1.at("value1").template as<int>(), 123);
+        BOOST_CHECK_EQUAL(section_1.template get<double>("value2"), 12.5);
+        BOOST_CHECK_EQUAL(section_1.template get<std::string>("value5", "nothing"), "nothing");
+        BOOST_CHECK(section_1.find("value5") == section_1.end());
+        BOOST_CHECK_THROW(section_1.at("value5"), std::out_of_range);
+
+        const auto& section_3 = copy.at("last_section");
+        BOOST_CHECK_EQUAL(section_3.at("str").template as<std::string>(), "test string");
+        BOOST_CHECK_EQUAL(section_3.template get<std::vector<std::string>>("arr").size(), 4);
+
+        size_t sections = 0, values = 0;
+        for(const auto& section: copy)
+        {
+            ++sections;
+            for(const auto& value: section.second)
+                values += section.second.find(value.first) != section.second.end();
+        }
+        BOOST_CHECK_EQUAL(sections, 3);
+        BOOST_CHECK_EQUAL(values, 10);
+
+        std::istringstream twice("[a]\nx=12\n[b]\n[a]");
+        BOOST_CHECK_THROW(ini::parse(std::istream_iterator<ini::Line<std::string>>(twice),
+                                     std::istream_iterator<ini::Line<std::string>>(), file),
+                          ini::double_section_definition);
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(StorageLookupTest, Storage, storage_types)
+    {
+        std::string text = "[s]\n";
+        for(size_t i = 0; i < 500; ++i)
+            text += "key_" + std::to_string(i * 7919 % 1000) + " = " + std::to_string(i) + "\n";
+        text += "a = first\nkey = prefix\nkey_999999999 = long\n";
+
+        std::istringstream iss(text);
+        ini::File<std::string, Storage> file;
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), file);
+
+        const auto& section = file.at("s");
+        for(size_t i = 0; i < 500; ++i)
+        {
+            BOOST_CHECK_EQUAL(section.template get<size_t>("key_" + std::to_string(i * 7919 % 1000)), i);
+            BOOST_CHECK(section.find("key_" + std::to_string(i * 7919 % 1000 + 1000)) == section.end());
+        }
+        BOOST_CHECK_EQUAL(section.at("a").template as<std::string>(), "first");
+        BOOST_CHECK_EQUAL(section.at("key").template as<std::string>(), "prefix");
+        BOOST_CHECK_EQUAL(section.at("key_999999999").template as<std::string>(), "long");
+        BOOST_CHECK(section.find("b") == section.end());
+        BOOST_CHECK(section.find("ke") == section.end());
+
+        static constexpr ini::key section_key("s"), value_key("key_999999999"), missing_key("key_1007");
+        const std::string_view text_view = text;
+        BOOST_CHECK_EQUAL(&file.at(section_key), &section);
+        BOOST_CHECK_EQUAL(&file.at(text_view.substr(1, 1)), &section);
+        BOOST_CHECK_EQUAL(section.template get<std::string>(value_key), "long");
+        BOOST_CHECK_EQUAL(&section.at(value_key), &section.at(std::string_view("key_999999999")));
+        BOOST_CHECK(section.find(missing_key) == section.end());
+        BOOST_CHECK_EQUAL(section.template get<int>(missing_key, -1), -1);
+        BOOST_CHECK_THROW(section.at(missing_key), std::out_of_range);
+    }
+
+    BOOST_AUTO_TEST_CASE(ViewFileTest)
+    {
+        const std::string filename = (std::filesystem::temp_directory_path() / "ini_view_file_test.ini").string();
+        std::ofstream(filename) << test;
+
+        ini::ViewFile file(filename);
+        std::remove(filename.c_str());
+
+        const ini::ViewSection& section_1 = file.at("Section1");
+        BOOST_CHECK_EQUAL(section_1.at("value1").as<int>(), 123);
+        BOOST_CHECK_EQUAL(section_1.at("value2").as<double>(), 12.5);
+        BOOST_CHECK_EQUAL(section_1.at("value3").as<std::string>(), "string");
+        BOOST_CHECK_EQUAL(section_1.get<std::string>("value5", "nothing"), "nothing");
+
+        const ini::ViewSection& section_2 = file.at("Section_2");
+        BOOST_CHECK_EQUAL(section_2.at("value___3").as<std::string>(), "sssssss");
+
+        const ini::ViewSection& section_3 = file.at("last_section");
+        BOOST_CHECK_EQUAL(section_3.at("str").as<std::string>(), "test string");
+        BOOST_CHECK(section_3.at("enum").as<user::test_enum>() == user::test_enum::three);
+        BOOST_CHECK_EQUAL(section_3.at("mult").view(), "several words string");
+
+        auto arr = section_3.get<std::vector<ini::Value>>("arr");
+        BOOST_REQUIRE_EQUAL(arr.size(), 4);
+        BOOST_CHECK_EQUAL(arr[3].as<std::string>(), "string");
+
+        ini::ViewFile moved = std::move(file);
+        BOOST_CHECK_EQUAL(moved.at("Section1").at("value1").as<int>(), 123);
+
+        // views into the mapping of a file with errors are not kept
+        std::ofstream(filename) << test << "\ninvalid line\n";
+        BOOST_CHECK_THROW(ini::parse(filename, moved), ini::parsing_fail);
+        BOOST_CHECK_EQUAL(moved.size(), 0);
+        std::remove(filename.c_str());
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(SnapshotTest, Storage, storage_types)
+    {
+        const auto temp = std::filesystem::temp_directory_path();
+        const std::string filename = (temp / "ini_snapshot_test.ini").string();
+        const std::string snapshot_filename = (temp / "ini_snapshot_test.snap").string();
+        std::ofstream(filename) << test;
+
+        std::istringstream iss(test);
+        ini::File<std::string, Storage> file;
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), file);
+        ini::write_snapshot(file, snapshot_filename, ini::source_of(filename));
+
+        ini::Snapshot snapshot(snapshot_filename);
+        BOOST_CHECK(snapshot.is_current(filename));
+        BOOST_CHECK_EQUAL(snapshot.size(), 3);
+        BOOST_CHECK_EQUAL(snapshot.at("Section1").at("value1").as<int>(), 123);
+        BOOST_CHECK_EQUAL(snapshot.at("Section1").get<double>("value2"), 12.5);
+        BOOST_CHECK_EQUAL(snapshot.at("Section1").get<std::string>("value5", "nothing"), "nothing");
+        BOOST_CHECK_EQUAL(snapshot.at("last_section").at("str").as<std::string>(), "test string");
+        BOOST_CHECK_EQUAL(snapshot.at("last_section").get<std::vector<std::string>>("arr").size(), 4);
+        BOOST_CHECK(snapshot.at("last_section").at("enum").as<user::test_enum>() == user::test_enum::three);
+        BOOST_CHECK(snapshot.find("Section3") == snapshot.end());
+        BOOST_CHECK_THROW(snapshot.at("Section3"), std::out_of_range);
+        BOOST_CHECK_THROW(snapshot.at("Section1").at("value5"), std::out_of_range);
+
+        size_t values = 0;
+        std::string_view previous;
+        for(const auto& section: snapshot)
+        {
+            BOOST_CHECK_LT(previous, section.first);
+            previous = section.first;
+            for(const auto& value: section.second)
+                values += value.second.view() == file.at(std::string(section.first)).at(std::string(value.first)).view();
+        }
+        BOOST_CHECK_EQUAL(values, 10);
+
+        ini::Snapshot moved = std::move(snapshot);
+        const ini::SnapshotSection section_2 = moved.at("Section_2");
+        ini::Snapshot target = std::move(moved);
+        BOOST_CHECK_EQUAL(section_2.at("value_2").as<double>(), 5.25);
+        BOOST_CHECK_EQUAL(moved.size(), 0);
+
+        // touched file with the same contents is still current, changed contents are not
+        std::ofstream(filename) << test;
+        BOOST_CHECK(target.is_current(filename));
+        std::ofstream(filename) << test << "\nx = 1";
+        BOOST_CHECK(!target.is_current(filename));
 
+        std::ofstream(snapshot_filename) << "INISNAP";
+        BOOST_CHECK_THROW(ini::Snapshot{snapshot_filename}, ini::invalid_snapshot);
+
+        const ini::Snapshot rebuilt = ini::load_snapshot(filename, snapshot_filename);
+        BOOST_CHECK_EQUAL(rebuilt.at("last_section").at("x").as<int>(), 1);
+        BOOST_CHECK_EQUAL(rebuilt.source().hash, ini::source_of(filename).hash);
+        const ini::Snapshot cached = ini::load_snapshot(filename, snapshot_filename);
+        BOOST_CHECK_EQUAL(cached.at("Section1").at("value1").as<int>(), 123);
+
+        // touched file keeps the snapshot, which records the new modification time
+        std::filesystem::last_write_time(filename, std::filesystem::last_write_time(filename) + std::chrono::hours(1));
+        const ini::Snapshot touched = ini::load_snapshot(filename, snapshot_filename);
+        BOOST_CHECK_EQUAL(touched.at("Section1").at("value1").as<int>(), 123);
+        BOOST_CHECK_EQUAL(ini::Snapshot(snapshot_filename).source().mtime, ini::source_of(filename).mtime);
+        BOOST_CHECK_EQUAL(ini::Snapshot(snapshot_filename).source().hash, rebuilt.source().hash);
+
+        // sizes of parts wrapping around to the size of the file
+        std::string image;
+        {
+            std::ifstream ifs(snapshot_filename, std::ios::binary);
+            image.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        }
+        ini::details::snapshot_header header;
+        std::memcpy(&header, image.data(), sizeof(header));
+        header.sections_count += 1000;
+        header.strings_size -= 1000 * sizeof(ini::details::snapshot_section);
+        std::memcpy(&image[0], &header, sizeof(header));
+        std::ofstream(snapshot_filename, std::ios::binary) << image;
+        BOOST_CHECK_THROW(ini::Snapshot{snapshot_filename}, ini::invalid_snapshot);
+
+        // threads writing a snapshot of the same file do not share the temporary file
+        std::atomic<size_t> failures{0};
+        std::vector<std::thread> writers;
+        for(size_t i = 0; i < 4; ++i)
+            writers.emplace_back([&]
+            {
+                for(size_t j = 0; j < 20; ++j)
+                {
+                    try
+                    {
+                        ini::write_snapshot(file, snapshot_filename);
+                    }
+                    catch(const std::system_error&)
+                    {
+                        ++failures;
+                    }
+                }
+            });
+        for(std::thread& writer: writers)
+            writer.join();
+        BOOST_CHECK_EQUAL(failures, 0);
+        BOOST_CHECK_EQUAL(ini::Snapshot(snapshot_filename).at("Section1").at("value1").as<int>(), 123);
+
+        std::remove(filename.c_str());
+        std::remove(snapshot_filename.c_str());
+    }
+
+    BOOST_AUTO_TEST_CASE(SharedSnapshotTest)
+    {
+        const std::string name = "/ini_shared_test_" + std::to_string(::getpid());
+        ini::SharedSnapshotPublisher publisher(name);
+        BOOST_CHECK_EQUAL(publisher.generation(), 0);
+
+        ini::SharedSnapshot reader(name);
+        BOOST_CHECK_EQUAL(reader.snapshot().size(), 0);
+        BOOST_CHECK(!reader.refresh());
+
+        std::istringstream iss(test);
+        ini::File<std::string> file;
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), file);
+        BOOST_CHECK_EQUAL(publisher.publish(file), 1);
+
+        // a worker forked before the update attaches on its own
+        const pid_t worker = ::fork();
+        if(worker == 0)
+        {
+            bool ok = false;
+            try
+            {
+                ini::SharedSnapshot attached(name);
+                ok = attached.generation() == 1 && attached.snapshot().at("Section1").at("value1").as<int>() == 123 &&
+                     attached.snapshot().at("last_section").get<std::string>("str") == "test string";
+            }
+            catch(...) {}
+            ::_exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        BOOST_REQUIRE_EQUAL(::waitpid(worker, &status, 0), worker);
+        BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        BOOST_CHECK(!reader.is_current());
+        BOOST_CHECK(reader.refresh());
+        BOOST_CHECK_EQUAL(reader.generation(), 1);
+        const ini::SnapshotSection section = reader.snapshot().at("Section1");
+        BOOST_CHECK_EQUAL(section.get<double>("value2"), 12.5);
+
+        // the mapped image stays unchanged until refresh
+        file.at("Section1").at("value1") = ini::Value("456");
+        BOOST_CHECK_EQUAL(publisher.publish(file), 2);
+        BOOST_CHECK_EQUAL(section.at("value1").as<int>(), 123);
+        BOOST_CHECK(!reader.is_current());
+        BOOST_CHECK(reader.refresh());
+        BOOST_CHECK_EQUAL(reader.snapshot().at("Section1").at("value1").as<int>(), 456);
+        BOOST_CHECK(reader.is_current());
+
+        // a restarted publisher continues the generations
+        ini::SharedSnapshotPublisher restarted(name);
+        BOOST_CHECK_EQUAL(restarted.generation(), 2);
+
+        publisher.unlink();
+        BOOST_CHECK_THROW(ini::SharedSnapshot{name}, std::system_error);
+        BOOST_CHECK_EQUAL(reader.snapshot().at("Section1").at("value1").as<int>(), 456);
+    }
+
+    BOOST_AUTO_TEST_CASE(LineIteratorTest)
+    {
+        const std::string buffer = "a\n\nb\nc";
+        std::istringstream iss(buffer);
+        std::vector<std::string> expected(std::istream_iterator<ini::Line<std::string>>(iss),
+                                          std::istream_iterator<ini::Line<std::string>>{});
+        std::vector<std::string> lines(ini::syntax::line_iterator<char>(buffer.data(), buffer.data() + buffer.size()),
+                                       ini::syntax::line_iterator<char>());
+        BOOST_CHECK(lines == expected);
+
+        const std::string trailing = "a\n";
+        BOOST_CHECK_EQUAL(std::distance(ini::syntax::line_iterator<char>(trailing.data(), trailing.data() + 2),
+                                        ini::syntax::line_iterator<char>()), 1);
+    }
+
+    //! Handler counting events and collecting errors instead of throwing
+    struct counting_handler : ini::event_handler<char>
+    {
+        void section(size_t, view_type name) { sections.emplace_back(name); }
+        void value(size_t, view_type name, view_type) { ++values; last_name = name; }
+        void comment(size_t, view_type) { ++comments; }
+        void error(size_t line_no, ini::error_code code, view_type) { errors.emplace_back(line_no, code); }
+
+        std::vector<std::string> sections;
+        std::string last_name;
+        size_t values = 0;
+        size_t comments = 0;
+        std::vector<std::pair<size_t, ini::error_code>> errors;
+    };
+
+    BOOST_AUTO_TEST_CASE(EventParserTest)
+    {
+        counting_handler handler;
+        ini::parse_events(std::string_view(test), handler);
+        BOOST_CHECK(handler.sections == std::vector<std::string>({"Section1", "Section_2", "last_section"}));
+        BOOST_CHECK_EQUAL(handler.values, 10);
+        BOOST_CHECK_EQUAL(handler.comments, 4);
+        BOOST_CHECK_EQUAL(handler.last_name, "arr");
+        BOOST_CHECK(handler.errors.empty());
+
+        std::istringstream iss("x = 1\n[a]\nbad line\ny = 2\n[a]\n");
+        counting_handler stream_handler;
+        ini::parse_events(iss, stream_handler);
+        BOOST_REQUIRE_EQUAL(stream_handler.errors.size(), 2);
+        BOOST_CHECK_EQUAL(stream_handler.errors[0].first, 1);
+        BOOST_CHECK(stream_handler.errors[0].second == ini::error_code::out_of_section_declaration);
+        BOOST_CHECK_EQUAL(stream_handler.errors[1].first, 3);
+        BOOST_CHECK(stream_handler.errors[1].second == ini::error_code::parsing_fail);
+        BOOST_CHECK_EQUAL(stream_handler.values, 1);
+        BOOST_CHECK_EQUAL(stream_handler.sections.size(), 2);
+
+        ini::event_handler<char> default_handler;
+        BOOST_CHECK_THROW(ini::parse_events(std::string_view("[a]\n=b"), default_handler), ini::parsing_fail);
+        BOOST_CHECK_THROW(ini::parse_events(std::string_view("a=b"), default_handler), ini::out_of_section_declaration);
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(NothrowParseTest, Storage, storage_types)
+    {
+        const std::string text = "x = 1\n"
+                                 "[a]\n"
+                                 "  bad line\n"
+                                 "y = 2\n"
+                                 "  y = 3\n"
+                                 "[b]\n"
+                                 "z = 4\n"
+                                 "[ a ]\n"
+                                 "w = 5\n";
+        ini::File<std::string, Storage> file;
+        const ini::parse_result result = ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                                                    ini::syntax::line_iterator<char>(), file, std::nothrow);
+        BOOST_CHECK(!result);
+        const auto& errors = result.diagnostics();
+        BOOST_REQUIRE_EQUAL(errors.size(), 4);
+        BOOST_CHECK(errors[0].code == ini::error_code::out_of_section_declaration);
+        BOOST_CHECK_EQUAL(errors[0].line_no, 1);
+        BOOST_CHECK_EQUAL(errors[0].column, 1);
+        BOOST_CHECK(errors[1].code == ini::error_code::parsing_fail);
+        BOOST_CHECK_EQUAL(errors[1].column, 3);
+        BOOST_CHECK(errors[2].code == ini::error_code::double_value_definition);
+        BOOST_CHECK_EQUAL(errors[2].line_no, 5);
+        BOOST_CHECK_EQUAL(errors[2].column, 3);
+        BOOST_CHECK(errors[3].code == ini::error_code::double_section_definition);
+        BOOST_CHECK_EQUAL(errors[3].column, 3);
+
+        // messages are the same as texts of exceptions thrown by parse()
+        BOOST_CHECK_EQUAL(result.message(errors[0]), ini::out_of_section_declaration(1).what());
+        BOOST_CHECK_EQUAL(result.message(errors[1]), ini::parsing_fail(3, "  bad line").what());
+        BOOST_CHECK_EQUAL(result.message(errors[2]), ini::double_value_definition(5, "a", "y").what());
+        BOOST_CHECK_EQUAL(result.message(errors[3]), ini::double_section_definition(8, "a").what());
+
+        // first definitions are kept, values of duplicate sections are skipped
+        BOOST_CHECK_EQUAL(file.size(), 2);
+        BOOST_CHECK_EQUAL(file.at("a").size(), 1);
+        BOOST_CHECK_EQUAL(file.at("a").template get<int>("y"), 2);
+        BOOST_CHECK_EQUAL(file.at("b").template get<int>("z"), 4);
+
+        std::istringstream iss(test);
+        ini::File<std::string, Storage> valid;
+        BOOST_CHECK(ini::parse(std::istream_iterator<ini::Line<std::string>>(iss),
+                               std::istream_iterator<ini::Line<std::string>>(), valid, std::nothrow).ok());
+        BOOST_CHECK_EQUAL(valid.size(), 3);
+
+        // malformed bytes of a file are reported as well, UTF-16LE "[a]" and an unpaired surrogate
+        const std::string filename = (std::filesystem::temp_directory_path() / "ini_nothrow_parse_test.ini").string();
+        std::ofstream(filename, std::ios::binary) << std::string("\xFF\xFE[\0a\0]\0\n\0\x00\xDC", 12);
+        ini::File<std::string, Storage> broken = valid;
+        const ini::parse_result encoding_result = ini::parse(filename, broken, std::nothrow);
+        std::remove(filename.c_str());
+        BOOST_REQUIRE_EQUAL(encoding_result.diagnostics().size(), 1);
+        const ini::diagnostic& encoding_error = encoding_result.diagnostics().front();
+        BOOST_CHECK(encoding_error.code == ini::error_code::invalid_encoding);
+        BOOST_CHECK_EQUAL(encoding_error.line_no, 0);
+        BOOST_CHECK_EQUAL(encoding_error.column, 10);
+        BOOST_CHECK_EQUAL(encoding_result.message(encoding_error), ini::invalid_encoding(10, "unpaired UTF-16 surrogate").what());
+        BOOST_CHECK_EQUAL(broken.size(), 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(PushParserTest)
+    {
+        ini::File<std::string> expected;
+        ini::parse(ini::syntax::line_iterator<char>(test.data(), test.data() + test.size()),
+                   ini::syntax::line_iterator<char>(), expected);
+
+        // every chunk size splits lines at different positions, the last line has no '\n'
+        for(size_t chunk_size = 1; chunk_size <= test.size(); ++chunk_size)
+        {
+            ini::File<std::string> file;
+            ini::file_push_parser<std::string> parser(file);
+            for(size_t pos = 0; pos < test.size(); pos += chunk_size)
+                parser.feed(std::string_view(test).substr(pos, chunk_size));
+            const auto last = file.find("last_section");
+            BOOST_CHECK(last == file.end() || last->second.find("arr") == last->second.end());
+            parser.finish();
+
+            for(const auto& section: expected)
+                for(const auto& value: section.second)
+                    BOOST_REQUIRE_EQUAL(file.at(section.first).at(value.first).as<std::string>(), value.second.as<std::string>());
+        }
+
+        counting_handler handler;
+        ini::push_parser<counting_handler, char> events(handler);
+        events.feed("[a]\nx = 1\n[b");
+        BOOST_CHECK_EQUAL(handler.sections.size(), 1);
+        BOOST_CHECK_EQUAL(handler.values, 1);
+        events.feed("]\nbroken");
+        BOOST_CHECK_EQUAL(handler.sections.size(), 2);
+        BOOST_CHECK_EQUAL(events.line_number(), 4);
+        events.finish();
+        BOOST_REQUIRE_EQUAL(handler.errors.size(), 1);
+        BOOST_CHECK_EQUAL(handler.errors[0].first, 4);
+
+        ini::File<std::string> file;
+        ini::file_push_parser<std::string> parser(file);
+        parser.feed("[a]\nx = 1\n");
+        BOOST_CHECK_THROW(parser.feed("x = 2\n"), ini::double_value_definition);
+    }
+
+    std::string generate_hosts(size_t hosts)
+    {
+        std::string res = "; generated inventory\n";
+        for(size_t i = 0; i < hosts; ++i)
+        {
+            res += "[host_" + std::to_string(i) + "]\n";
+            res += "address = 10.0." + std::to_string(i / 256 % 256) + "." + std::to_string(i % 256) + "\n";
+            res += "port = " + std::to_string(1000 + i) + "\n";
+            for(size_t j = 0; j < 24; ++j)
+                res += "option_" + std::to_string(j) + " = value of option " + std::to_string(j) + "\n";
+            res += "\n";
+        }
+        return res;
+    }
+
+    template <typename File>
+    size_t error_line(const std::string& text, size_t threads_count)
+    {
+        File file;
+        try
+        {
+            if(threads_count == 0)
+                ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                           ini::syntax::line_iterator<char>(), file);
+            else
+                ini::parse_parallel(std::string_view(text), file, threads_count);
+        }
+        catch(const ini::parsing_error& e)
+        {
+            return e.getLineNumber();
+        }
+        return 0;
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(ParallelParseTest, Storage, storage_types)
+    {
+        using file_type = ini::File<std::string, Storage>;
+
+        const std::string text = generate_hosts(1000);
+        file_type expected;
+        ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                   ini::syntax::line_iterator<char>(), expected);
+
+        for(size_t threads_count: {1, 2, 3, 8})
+        {
+            file_type file;
+            ini::parse_parallel(text, file, threads_count);
+            size_t sections = 0;
+            for(const auto& section: expected)
+            {
+                ++sections;
+                const auto& parsed = file.at(section.first);
+                BOOST_REQUIRE_EQUAL(parsed.template get<int>("port"), section.second.template get<int>("port"));
+            }
+            BOOST_CHECK_EQUAL(std::distance(file.begin(), file.end()), sections);
+        }
+
+        ini::File<std::string_view, Storage> views;
+        ini::parse_parallel(std::string_view(text), views, 4);
+        BOOST_CHECK_EQUAL(views.at("host_999").at("port").template as<int>(), 1999);
+
+        // errors in different chunks, the first one in text order must be reported
+        std::string broken = text;
+        broken.insert(broken.find("[host_500]"), "[host_10]\n");
+        broken.insert(broken.find("[host_800]"), "invalid line\n");
+        const size_t line = error_line<file_type>(broken, 0);
+        BOOST_CHECK_EQUAL(line, 500 * 28 + 2);
+        for(size_t threads_count: {1, 2, 4, 8})
+            BOOST_CHECK_EQUAL(error_line<file_type>(broken, threads_count), line);
+
+        broken = text;
+        broken.insert(broken.find("address", broken.find("[host_432]")), "port = 1\n");
+        broken.insert(broken.find("[host_900]"), "[host_3]\n");
+        for(size_t threads_count: {1, 2, 4, 8})
+            BOOST_CHECK_EQUAL(error_line<file_type>(broken, threads_count), error_line<file_type>(broken, 0));
+
+        BOOST_CHECK_EQUAL(error_line<file_type>("x = 1\n" + text, 4), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(LoadFilesTest, Storage, storage_types)
+    {
+        using file_type = ini::File<std::string, Storage>;
+
+        const auto root = std::filesystem::temp_directory_path() / "ini_load_files_test";
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "conf.d");
+        const auto write = [&root](const std::string& name, const std::string& text)
+        {
+            std::ofstream(root / name) << text;
+        };
+        write("main.ini", "[server]\nport = 80\nhost = localhost\n"
+                          "include defaults.ini ; before the drop-ins\n"
+                          "workers = 4\n"
+                          "include conf.d/*.conf\n"
+                          "[client]\ntimeout = 10\n");
+        write("defaults.ini", "[server]\nhost = default\nbacklog = 128\n[logging]\nlevel = info\n");
+        write("conf.d/10-port.conf", "[server]\nport = 8080\n");
+        write("conf.d/20-log.conf", "[logging]\nlevel = debug\ninclude ../defaults.ini\n");
+        write("conf.d/30-copy.conf", "[server]\nport = 8080\n");
+        write("conf.d/.hidden.conf", "[server]\nport = 1\n");
+        write("conf.d/readme.txt", "not an ini file");
+
+        for(size_t threads_count: {1, 2, 8})
+        {
+            file_type file;
+            ini::load_files((root / "main.ini").string(), file, threads_count);
+            BOOST_CHECK_EQUAL(std::distance(file.begin(), file.end()), 3);
+            const auto& server = file.at("server");
+            BOOST_CHECK_EQUAL(server.template get<int>("port"), 8080);
+            BOOST_CHECK_EQUAL(server.template get<std::string>("host"), "default");
+            BOOST_CHECK_EQUAL(server.template get<int>("backlog"), 128);
+            BOOST_CHECK_EQUAL(server.template get<int>("workers"), 4);
+            // defaults.ini is merged once at its first include, so the drop-in wins
+            BOOST_CHECK_EQUAL(file.at("logging").template get<std::string>("level"), "debug");
+            BOOST_CHECK_EQUAL(file.at("client").template get<int>("timeout"), 10);
+
+            file_type expected;
+            ini::parse((root / "defaults.ini").string(), expected);
+            ini::load_files((root / "defaults.ini").string(), file, threads_count);
+            BOOST_CHECK_EQUAL(file.at("server").content_hash(), expected.at("server").content_hash());
+        }
+
+        // directories are loaded whole
+        file_type file;
+        BOOST_CHECK_THROW(ini::load_files((root / "conf.d").string(), file), ini::out_of_section_declaration);
+        std::filesystem::remove(root / "conf.d" / "readme.txt");
+        ini::load_files((root / "conf.d").string(), file);
+        BOOST_CHECK_EQUAL(file.at("server").template get<int>("port"), 8080);
+        BOOST_CHECK_EQUAL(file.at("server").template get<std::string>("host"), "default");
+        ini::load_files(std::vector<std::string>{(root / "conf.d/*.conf").string(), (root / "main.ini").string()}, file);
+        BOOST_CHECK_EQUAL(file.at("server").template get<int>("port"), 80);
+        ini::load_files((root / "conf.d/*.ini").string(), file);
+        BOOST_CHECK_EQUAL(std::distance(file.begin(), file.end()), 0);
+
+        // errors carry the file they were found in, the first one in merge order is reported
+        write("conf.d/20-log.conf", "[logging]\nlevel = debug\nlevel = trace\n");
+        write("conf.d/40-broken.conf", "[broken]\ninvalid line\n");
+        try
+        {
+            ini::load_files((root / "main.ini").string(), file, 4);
+            BOOST_ERROR("double_value_definition expected");
+        }
+        catch(const ini::double_value_definition& e)
+        {
+            BOOST_CHECK_EQUAL(e.getLineNumber(), 3);
+            BOOST_CHECK_EQUAL(e.getFileName(), (root / "conf.d" / "20-log.conf").string());
+            BOOST_CHECK_EQUAL(std::string(e.what()).find(e.getFileName() + ": Error in line 3"), 0);
+        }
+
+        write("conf.d/20-log.conf", "[logging]\nlevel = debug\n[logging]\n");
+        BOOST_CHECK_THROW(ini::load_files((root / "conf.d").string(), file), ini::double_section_definition);
+        write("conf.d/20-log.conf", "[logging]\nlevel = debug\ninclude missing.ini\nlevel = trace\n");
+        try
+        {
+            ini::load_files((root / "conf.d").string(), file);
+            BOOST_ERROR("include_error expected");
+        }
+        catch(const ini::include_error& e)
+        {
+            BOOST_CHECK_EQUAL(e.getLineNumber(), 3);
+            BOOST_CHECK_EQUAL(e.getFileName(), (root / "conf.d" / "20-log.conf").string());
+        }
+        // duplicates are searched across include directives
+        write("conf.d/20-log.conf", "[logging]\nlevel = debug\ninclude ../defaults.ini\nlevel = trace\n");
+        BOOST_CHECK_THROW(ini::load_files((root / "conf.d").string(), file), ini::double_value_definition);
+
+        std::filesystem::remove(root / "conf.d" / "20-log.conf");
+        try
+        {
+            ini::load_files((root / "conf.d").string(), file);
+            BOOST_ERROR("parsing_fail expected");
+        }
+        catch(const ini::parsing_fail& e)
+        {
+            BOOST_CHECK_EQUAL(e.getLineNumber(), 2);
+            BOOST_CHECK_EQUAL(e.getFileName(), (root / "conf.d" / "40-broken.conf").string());
+        }
+        // UTF-16LE "[b]\n" and an unpaired surrogate
+        write("conf.d/40-broken.conf", std::string("\xFF\xFE[\0b\0]\0\n\0\x00\xDC", 12));
+        try
+        {
+            ini::load_files((root / "conf.d").string(), file);
+            BOOST_ERROR("invalid_encoding expected");
+        }
+        catch(const ini::invalid_encoding& e)
+        {
+            BOOST_CHECK_EQUAL(e.offset(), 10);
+            BOOST_CHECK_EQUAL(e.getFileName(), (root / "conf.d" / "40-broken.conf").string());
+            BOOST_CHECK_EQUAL(std::string(e.what()).find(e.getFileName() + ": Invalid encoding at byte 10"), 0);
+        }
+        BOOST_CHECK_THROW(ini::load_files((root / "absent.ini").string(), file), std::system_error);
+        std::filesystem::remove_all(root);
+    }
+
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(LazyFileTest, Storage, storage_types)
+    {
+        using lazy_file = ini::LazyFile<std::string_view, Storage>;
+
+        auto file = lazy_file::from_text(test);
+        BOOST_CHECK_EQUAL(file.size(), 3);
+        BOOST_CHECK(file.find("Section3") == nullptr);
+        BOOST_CHECK_THROW(file.at("Section3"), std::out_of_range);
+        BOOST_CHECK_EQUAL(file.at("Section1").at("value1").template as<int>(), 123);
+        BOOST_CHECK_EQUAL(file.at("Section_2").at("value___3").template as<std::string>(), "sssssss");
+        BOOST_CHECK_EQUAL(file.at("last_section").template get<std::vector<std::string>>("arr").size(), 4);
+        BOOST_CHECK_EQUAL(&file.at("Section1"), file.find("Section1"));
+
+        // errors inside sections are found on access, with the line numbers of eager parsing
+        auto broken = lazy_file::from_text(";comment\n[good]\na = 1\n[ bad ]\nb = 2\n[x y]\n  [last]\nc = 3");
+        BOOST_CHECK_EQUAL(broken.size(), 3);
+        BOOST_CHECK_EQUAL(broken.at("last").at("c").template as<int>(), 3);
+        try
+        {
+            broken.at("bad");
+            BOOST_ERROR("exception expected");
+        }
+        catch(const ini::parsing_fail& e)
+        {
+            BOOST_CHECK_EQUAL(e.getLineNumber(), 6);
+        }
+        BOOST_CHECK_THROW(broken.at("bad"), ini::parsing_fail);
+
+        BOOST_CHECK_THROW(lazy_file::from_text("[a]\n[b]\n[a]\n"), ini::double_section_definition);
+        BOOST_CHECK_THROW(lazy_file::from_text("x = 1\n[a]\n"), ini::out_of_section_declaration);
+        BOOST_CHECK_THROW(lazy_file::from_text("[a]\nx = 1\nx = 2\n").at("a"), ini::double_value_definition);
+
+        auto wide = ini::LazyFile<std::wstring, Storage>::from_text(L"[a]\nb = [1, 2]\n");
+        BOOST_CHECK_EQUAL(wide.at(L"a").at(L"b").template as<std::vector<int>>().size(), 2);
+
+        const std::string hosts = generate_hosts(200);
+        auto shared = lazy_file::from_text(hosts);
+        std::vector<std::thread> threads;
+        std::vector<const typename lazy_file::section_type*> results(4);
+        for(size_t i = 0; i < results.size(); ++i)
+            threads.emplace_back([&, i] { results[i] = &shared.at("host_123"); });
+        for(auto& t: threads)
+            t.join();
+        BOOST_CHECK(std::all_of(results.begin(), results.end(), [&](auto res) { return res == results[0]; }));
+        BOOST_CHECK_EQUAL(results[0]->at("port").template as<int>(), 1123);
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(PersistentFileTest, Storage, storage_types)
+    {
+        std::istringstream iss(test);
+        ini::File<std::string, Storage> parsed;
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), parsed);
+
+        const ini::PersistentFile<> file(parsed);
+        BOOST_CHECK_EQUAL(file.size(), 3);
+        BOOST_CHECK_EQUAL(file.at("Section1").at("value1").as<int>(), 123);
+        BOOST_CHECK_EQUAL(file.at("Section_2").get<double>("value_2"), 5.25);
+        BOOST_CHECK_EQUAL(file.at("Section1").get<std::string>("value5", "nothing"), "nothing");
+        BOOST_CHECK_THROW(file.at("Section3"), std::out_of_range);
+        BOOST_CHECK(file.find("Section3") == file.end());
+
+        std::vector<std::string> names;
+        for(const auto& section: file)
+            names.push_back(section.first);
+        BOOST_CHECK((names == std::vector<std::string>{"Section1", "Section_2", "last_section"}));
+
+        // copies share everything
+        const auto section_1 = file.at("Section1");
+        BOOST_CHECK(section_1.shares_with(file.at("Section1")));
+        BOOST_CHECK_EQUAL(&section_1.at("value1"), &file.at("Section1").at("value1"));
+
+        // a change shares untouched sections and values with the previous version
+        const auto changed = file.set("Section1", "value1", "456");
+        BOOST_CHECK_EQUAL(changed.at("Section1").at("value1").as<int>(), 456);
+        BOOST_CHECK_EQUAL(file.at("Section1").at("value1").as<int>(), 123);
+        BOOST_CHECK(changed.at("Section_2").shares_with(file.at("Section_2")));
+        BOOST_CHECK_EQUAL(&changed.at("Section1").at("value2"), &file.at("Section1").at("value2"));
+
+        const auto added = changed.set("new", "key", "value").erase("last_section");
+        BOOST_CHECK_EQUAL(added.size(), 3);
+        BOOST_CHECK_EQUAL(added.at("new").at("key").as<std::string>(), "value");
+        BOOST_CHECK(added.find("last_section") == added.end());
+        BOOST_CHECK(changed.erase("Section1", "value7").shares_with(changed));
+        BOOST_CHECK_EQUAL(changed.erase("Section1", "value1").at("Section1").size(), 2);
+
+        // reloaded versions share equal sections
+        const ini::PersistentFile<> reloaded(parsed, changed);
+        BOOST_CHECK(reloaded.at("Section_2").shares_with(file.at("Section_2")));
+        BOOST_CHECK(!reloaded.at("Section1").shares_with(changed.at("Section1")));
+        BOOST_CHECK(reloaded.at("Section1") == file.at("Section1"));
+
+        // every intermediate version stays balanced and ordered
+        ini::PersistentSection<> section;
+        std::vector<ini::PersistentSection<>> versions;
+        for(int i = 0; i < 500; ++i)
+        {
+            section = section.set("key" + std::to_string(i * 7919 % 500), std::to_string(i));
+            versions.push_back(section);
+        }
+        for(int i = 0; i < 500; i += 2)
+            section = section.erase("key" + std::to_string(i));
+        BOOST_CHECK_EQUAL(section.size(), 250);
+        BOOST_CHECK(std::is_sorted(section.begin(), section.end(), [](const auto& l, const auto& r) { return l.first < r.first; }));
+        BOOST_CHECK_EQUAL(std::distance(section.begin(), section.end()), 250);
+        for(size_t i = 0; i < versions.size(); ++i)
+            BOOST_CHECK_EQUAL(versions[i].size(), i + 1);
+        BOOST_CHECK_EQUAL(versions[10].get<int>("key" + std::to_string(10 * 7919 % 500)), 10);
+        BOOST_CHECK(versions[10].find("key" + std::to_string(11 * 7919 % 500)) == versions[10].end());
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(DiffTest, Storage, storage_types)
+    {
+        using file_type = ini::File<std::string, Storage>;
+        const auto parse_text = [](const std::string& text)
+        {
+            file_type res;
+            std::istringstream iss(text);
+            ini::parse(std::istream_iterator<ini::Line<std::string>>(iss), std::istream_iterator<ini::Line<std::string>>(), res);
+            return res;
+        };
+
+        const file_type from = parse_text(test);
+        BOOST_CHECK(ini::diff(from, parse_text(test)).empty());
+
+        std::string changed_text = test;
+        changed_text.replace(changed_text.find("value1 = 123"), 12, "value1 = 124");
+        changed_text.replace(changed_text.find("[last_section]"), 14, "[renamed]");
+        changed_text.insert(changed_text.find("value___3"), "value_0 = 10\n");
+        changed_text.erase(changed_text.find("  value_1: 21\n"), 14);
+        // same values in another order are not a change
+        changed_text.insert(0, "[a]\nx = 11\ny = 22\n");
+        const file_type to = parse_text(changed_text);
+
+        const auto changes = ini::diff(from, to);
+        using ini::change_type;
+        const std::vector<std::tuple<change_type, std::string, std::string, std::string, std::string>> expected{
+                {change_type::value_changed, "Section1", "value1", "123", "124"},
+                {change_type::value_added, "Section_2", "value_0", "", "10"},
+                {change_type::value_removed, "Section_2", "value_1", "21", ""},
+                {change_type::section_added, "a", "", "", ""},
+                {change_type::section_removed, "last_section", "", "", ""},
+                {change_type::section_added, "renamed", "", "", ""}};
+        BOOST_REQUIRE_EQUAL(changes.size(), expected.size());
+        for(size_t i = 0; i < changes.size(); ++i)
+        {
+            const auto& c = changes[i];
+            BOOST_CHECK(std::make_tuple(c.type, std::string(c.section), std::string(c.name), std::string(c.old_value),
+                                        std::string(c.new_value)) == expected[i]);
+        }
+
+        BOOST_CHECK_EQUAL(parse_text("[a]\nx = 11\ny = 22\n").at("a").content_hash(),
+                          parse_text("[a]\ny = 22\nx = 11\n").at("a").content_hash());
+        BOOST_CHECK_NE(parse_text("[a]\nx = 1\n").at("a").content_hash(), parse_text("[a]\nx = 2\n").at("a").content_hash());
+        BOOST_CHECK(ini::diff(parse_text("[a]\nx = 11\ny = 22\n"), parse_text("[a]\ny = 22\nx = 11\n")).empty());
+
+        // values assigned after parsing are hashed too
+        const auto original = parse_text("[a]\nx = 11\ny = 22\n");
+        auto assigned = original;
+        assigned.at("a").at("x") = ini::Value("33");
+        BOOST_CHECK_EQUAL(assigned.at("a").content_hash(), parse_text("[a]\nx = 33\ny = 22\n").at("a").content_hash());
+        const auto assigned_changes = ini::diff(original, assigned);
+        BOOST_REQUIRE_EQUAL(assigned_changes.size(), 1);
+        BOOST_CHECK(assigned_changes[0].type == change_type::value_changed);
+        BOOST_CHECK_EQUAL(std::string(assigned_changes[0].new_value), "33");
+    }
+
+    BOOST_AUTO_TEST_CASE(SchemaTest)
+    {
+        const std::string text = "[server]\n"
+                                 "host = example.com\n"
+                                 "port = 8080\n"
+                                 "timeout = 2.5\n"
+                                 "retries = [1, 2, 4]\n"
+                                 "unknown = value\n"
+                                 "[log]\n"
+                                 "verbose = true\n"
+                                 "port = 99\n";
+
+        const auto check = [](const server_config& config)
+        {
+            BOOST_CHECK_EQUAL(config.host, "example.com");
+            BOOST_CHECK_EQUAL(config.port, 8080);
+            BOOST_CHECK_EQUAL(config.timeout, 2.5);
+            BOOST_CHECK((config.retries == std::vector<int>{1, 2, 4}));
+            BOOST_CHECK(config.verbose);
+        };
+        check(ini::load(text, server_schema));
+        std::istringstream iss(text);
+        check(ini::load(iss, server_schema));
+
+        ini::File<std::string, ini::hash_storage> file;
+        std::istringstream file_iss(text);
+        ini::parse(std::istream_iterator<ini::Line<std::string>>(file_iss), std::istream_iterator<ini::Line<std::string>>(), file);
+        check(ini::load(file, server_schema));
+
+        // defaults are the initial values of the struct, all errors are reported at once
+        server_config config;
+        const auto errors = ini::bind("[server]\nport = eighty\n[log]\nverbose = 1\n", server_schema, config);
+        BOOST_REQUIRE_EQUAL(errors.size(), 2);
+        BOOST_CHECK_EQUAL(errors[0].name, "port");
+        BOOST_CHECK(!errors[0].missing);
+        BOOST_CHECK_EQUAL(errors[0].line_no, 2);
+        BOOST_CHECK_EQUAL(errors[1].name, "timeout");
+        BOOST_CHECK(errors[1].missing);
+        BOOST_CHECK_EQUAL(config.host, "localhost");
+        BOOST_CHECK_EQUAL(config.port, 80);
+        BOOST_CHECK(config.verbose);
+
+        try
+        {
+            ini::load("[server]\n", server_schema);
+            BOOST_ERROR("exception expected");
+        }
+        catch(const ini::binding_error& e)
+        {
+            BOOST_CHECK_EQUAL(e.errors().size(), 2);
+            BOOST_CHECK_EQUAL(e.what(), std::string("Could not bind fields: 'server.port' missing; 'server.timeout' missing"));
+        }
+        BOOST_CHECK_THROW(ini::load("port = 1\n", server_schema), ini::out_of_section_declaration);
+        BOOST_CHECK_THROW(ini::load("[server]\nport = 1\nport = 2\ntimeout = 1\n", server_schema), ini::double_value_definition);
+        BOOST_CHECK_THROW(ini::load("[server]\nport = 1\ntimeout = 1\n[log]\n[server]\nport = 3\n", server_schema),
+                          ini::double_section_definition);
+        BOOST_CHECK_THROW(ini::make_schema(ini::field("a", "b", &server_config::port), ini::field("a", "b", &server_config::host)),
+                          std::invalid_argument);
+    }
+
+    BOOST_AUTO_TEST_CASE_TEMPLATE(InterpolateTest, Storage, storage_types)
+    {
+        using file_type = ini::File<std::string, Storage>;
+
+        const auto parse = [](const std::string& text)
+        {
+            file_type file;
+            ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+                       ini::syntax::line_iterator<char>(), file);
+            return file;
+        };
+
+        ::setenv("INI_INTERPOLATE_TEST", "/opt/app", 1);
+        file_type file = parse("[paths]\n"
+                               "root = ${env:INI_INTERPOLATE_TEST}\n"
+                               "logs = ${root}/logs\n"
+                               "current = ${logs}/current.log\n"
+                               "[server]\n"
+                               "log = ${paths:current}\n"
+                               "port = 80\n"
+                               "url = http://${host}:${port}/\n"
+                               "host = example.com\n"
+                               "price = $5 $${not a reference}\n");
+        file_type expected = parse("[paths]\n"
+                                   "root = /opt/app\n"
+                                   "logs = /opt/app/logs\n"
+                                   "current = /opt/app/logs/current.log\n"
+                                   "[server]\n"
+                                   "log = /opt/app/logs/current.log\n"
+                                   "port = 80\n"
+                                   "url = http://example.com:80/\n"
+                                   "host = example.com\n"
+                                   "price = $5 ${not a reference}\n");
+        ini::interpolate(file);
+        for(const auto& section: expected)
+        {
+            for(const auto& value: section.second)
+                BOOST_CHECK_EQUAL(file.at(section.first).at(value.first).view(), value.second.view());
+            BOOST_CHECK_EQUAL(file.at(section.first).content_hash(), section.second.content_hash());
+        }
+
+        // references are replaced with strings of values, quotes inside them are escaped
+        file = parse("[user]\n"
+                     "name = \"John\"\n"
+                     "greet = Hello ${name}!\n"
+                     "quoted = \"Hello ${name}!\"\n"
+                     "said = He said \\\"hi\\\"\n"
+                     "quote = \"${name}: ${said}\"\n"
+                     "nested = \"<${quote}>\"\n");
+        ini::interpolate(file);
+        const auto& user = file.at("user");
+        BOOST_CHECK_EQUAL(user.at("greet").view(), "Hello John!");
+        BOOST_CHECK_EQUAL(user.at("quoted").view(), "\"Hello John!\"");
+        BOOST_CHECK_EQUAL(user.at("quoted").template as<std::string>(), "Hello John!");
+        BOOST_CHECK_EQUAL(user.at("quote").view(), "\"John: He said \\\"hi\\\"\"");
+        BOOST_CHECK_EQUAL(user.at("quote").template as<std::string>(), "John: He said \"hi\"");
+        BOOST_CHECK_EQUAL(user.at("nested").template as<std::string>(), "<John: He said \"hi\">");
+
+        // every value of a long chain is resolved once
+        std::string chain = "[chain]\nkey_0 = xy\n";
+        for(size_t i = 1; i < 5000; ++i)
+            chain += "key_" + std::to_string(i) + " = ${key_" + std::to_string(i - 1) + "}\n";
+        file = parse(chain);
+        ini::interpolate(file);
+        BOOST_CHECK_EQUAL(file.at("chain").at("key_4999").view(), "xy");
+
+        const auto check_error = [&parse](const std::string& text, const std::string& name, const std::string& reason)
+        {
+            file_type file = parse(text);
+            const file_type original = file;
+            try
+            {
+                ini::interpolate(file);
+                BOOST_ERROR("interpolation_error expected");
+            }
+            catch(const ini::interpolation_error& e)
+            {
+                BOOST_CHECK_EQUAL(e.section() + "." + e.name(), name);
+                BOOST_CHECK_EQUAL(std::string(e.what()), "Could not interpolate '" + name + "': " + reason);
+            }
+            for(const auto& section: original)
+                for(const auto& value: section.second)
+                    BOOST_CHECK_EQUAL(file.at(section.first).at(value.first).view(), value.second.view());
+        };
+        check_error("[a]\nx = ${b:y}\n[b]\ny = ${c:z}\n[c]\nz = ${a:x}\n", "a.x",
+                    "circular reference a.x -> b.y -> c.z -> a.x");
+        check_error("[a]\nx = ${x}\n", "a.x", "circular reference a.x -> a.x");
+        check_error("[a]\nx = ${b:y}\ny = 1\n", "a.x", "reference to missing section 'b'");
+        check_error("[a]\nx = ${z}\n", "a.x", "reference to missing value 'a.z'");
+        check_error("[a]\nx = 1 ${y\ny = 1\n", "a.x", "unterminated reference '${y'");
+        check_error("[a]\nx = ${env:INI_INTERPOLATE_TEST_UNSET}\n", "a.x",
+                    "environment variable 'INI_INTERPOLATE_TEST_UNSET' is not set");
+    }
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,123 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "reloader.h"
+
+namespace
+{
+
+//! Replace file atomically the way deployment tools do
+void write_version(const std::string& filename, int version)
+{
+    const std::string temp = filename + ".tmp";
+    {
+        std::ofstream ofs(temp);
+        ofs << "[s]\nversion = " << version << "\n";
+        for(int i = 0; i < 50; ++i)
+            ofs << "key_" << i << " = " << i << "\n";
+        ofs << "copy = " << version << "\n";
+    }
+    std::rename(temp.c_str(), filename.c_str());
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ReloaderTestSuit)
+
+    BOOST_AUTO_TEST_CASE(ReloadStressTest)
+    {
+        const std::string filename = (std::filesystem::temp_directory_path() / "ini_reloader_test.ini").string();
+        write_version(filename, 0);
+        ini::Reloader<> reloader(filename);
+        BOOST_CHECK_EQUAL(reloader.version(), 1);
+
+        std::atomic<bool> done{false};
+        std::atomic<size_t> reads{0};
+        std::atomic<size_t> failures{0};
+        std::vector<std::thread> readers;
+        const unsigned threads_count = std::min(8u, std::max(2u, std::thread::hardware_concurrency()));
+        for(unsigned t = 0; t < threads_count; ++t)
+        {
+            readers.emplace_back([&]
+            {
+                uint64_t last_version = 0;
+                int last_value = 0;
+                while(!done.load())
+                {
+                    const auto file = reloader.read();
+                    const auto& section = file->at("s");
+                    const int value = section.at("version").as<int>();
+                    if(value != section.at("copy").as<int>() || file.version() < last_version ||
+                       (file.version() > last_version && value < last_value))
+                        ++failures;
+                    last_version = file.version();
+                    last_value = value;
+                    ++reads;
+                }
+            });
+        }
+
+        for(int version = 1; version <= 100; ++version)
+        {
+            write_version(filename, version);
+            BOOST_CHECK(reloader.reload());
+        }
+
+        // watcher picks up changes without reload() calls
+        write_version(filename, 1000);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while(reloader.read()->at("s").at("version").as<int>() != 1000 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        BOOST_CHECK_EQUAL(reloader.read()->at("s").at("version").as<int>(), 1000);
+
+        done = true;
+        for(auto& t: readers)
+            t.join();
+        BOOST_CHECK_EQUAL(failures.load(), 0);
+        BOOST_CHECK_GT(reads.load(), 0);
+        BOOST_CHECK_GE(reloader.version(), 102);
+
+        // broken version is not published
+        std::ofstream(filename) << "[s]\nversion = 1\nversion = 2\n";
+        BOOST_CHECK(!reloader.reload());
+        BOOST_CHECK(reloader.last_error() != nullptr);
+        BOOST_CHECK_EQUAL(reloader.read()->at("s").at("copy").as<int>(), 1000);
+
+        std::remove(filename.c_str());
+    }
+
+    BOOST_AUTO_TEST_CASE(ManualReloadTest)
+    {
+        const std::string filename = (std::filesystem::temp_directory_path() / "ini_manual_reload_test.ini").string();
+        write_version(filename, 1);
+        ini::Reloader<std::string, ini::hash_storage> reloader(filename, false);
+
+        auto old = reloader.read();
+        write_version(filename, 2);
+        std::thread writer([&] { reloader.reload(); });
+        // old version stays alive while the guard exists
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while(reloader.read().version() != 2 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        BOOST_CHECK_EQUAL(old->at("s").at("version").as<int>(), 1);
+        BOOST_CHECK_EQUAL(old.version(), 1);
+        BOOST_CHECK_EQUAL(reloader.read()->at("s").at("version").as<int>(), 2);
+        {
+            const auto moved = std::move(old);
+            BOOST_CHECK_EQUAL(moved.version(), 1);
+        }
+        writer.join();
+        BOOST_CHECK_EQUAL(reloader.version(), 2);
+
+        std::remove(filename.c_str());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <typeindex>
+#include "parser.h"
+#include "parallel.h"
+
+namespace
+{
+
+//! Collector counting allocations of a memory resource given to parsed files
+class counting_collector : public ini::stats_collector, public std::pmr::memory_resource
+{
+public:
+    ini::allocation_counters allocations() const override { return m_counters; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++m_counters.allocations;
+        m_counters.bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    ini::allocation_counters m_counters;
+};
+
+//! Installs observer for the scope of a test
+struct observer_guard
+{
+    explicit observer_guard(ini::stats_observer* observer) { ini::set_stats_observer(observer); }
+    ~observer_guard() { ini::set_stats_observer(nullptr); }
+};
+
+template <typename File>
+void parse_text(const std::string& text, File& file)
+{
+    ini::parse(ini::syntax::line_iterator<char>(text.data(), text.data() + text.size()),
+               ini::syntax::line_iterator<char>(), file);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(StatsTestSuit)
+
+    BOOST_AUTO_TEST_CASE(ParseStatsTest)
+    {
+        const std::string text = "; header\n"
+                                 "[section_with_a_long_name]\n"
+                                 "value_with_a_long_name = 1 ; trailing\n"
+                                 "\n"
+                                 "another_value_with_a_long_name = a long string value of the option\n"
+                                 "[second]\n"
+                                 "x = 2\n";
+        counting_collector collector;
+        observer_guard guard(&collector);
+
+        ini::pmr::File<> file(&collector);
+        parse_text(text, file);
+        BOOST_CHECK_EQUAL(collector.parses(), 1);
+        ini::parse_stats stats = collector.totals();
+        BOOST_CHECK_EQUAL(stats.lines, 7);
+        BOOST_CHECK_EQUAL(stats.sections, 2);
+        BOOST_CHECK_EQUAL(stats.values, 3);
+        BOOST_CHECK_EQUAL(stats.comments, 2);
+        BOOST_CHECK_EQUAL(stats.errors, 0);
+        BOOST_CHECK_EQUAL(stats.bytes, text.size());
+        BOOST_CHECK_GT(stats.allocations, 0);
+        BOOST_CHECK_GE(stats.allocated_bytes, text.size() / 2);
+        BOOST_CHECK(stats.total_time >= stats.lex_time + stats.insert_time + stats.read_time);
+
+        // failed parses are reported too, nothrow parse counts every bad line
+        collector.reset();
+        BOOST_CHECK_THROW(parse_text("[s]\nbad line\n", file), ini::parsing_error);
+        const std::string invalid = "x = 1\n[s]\n!\n!\n";
+        ini::parse_result res = ini::parse(ini::syntax::line_iterator<char>(invalid.data(), invalid.data() + invalid.size()),
+                                           ini::syntax::line_iterator<char>(), file, std::nothrow);
+        BOOST_CHECK(!res);
+        BOOST_CHECK_EQUAL(collector.parses(), 2);
+        stats = collector.totals();
+        BOOST_CHECK_EQUAL(stats.lines, 6);
+        BOOST_CHECK_EQUAL(stats.errors, 4);
+        BOOST_CHECK_EQUAL(stats.sections, 2);
+    }
+
+    BOOST_AUTO_TEST_CASE(ParallelParseStatsTest)
+    {
+        std::string text;
+        for(int i = 0; text.size() < 512 * 1024; ++i)
+        {
+            text += "[section_" + std::to_string(i) + "]\n; comment\n";
+            for(int j = 0; j < 20; ++j)
+                text += "value_" + std::to_string(j) + " = " + std::to_string(i * j) + "\n";
+        }
+
+        ini::stats_collector sequential;
+        {
+            observer_guard guard(&sequential);
+            ini::File<std::string> file;
+            parse_text(text, file);
+        }
+        ini::stats_collector parallel;
+        {
+            observer_guard guard(&parallel);
+            ini::File<std::string> file;
+            ini::parse_parallel(text, file, 4);
+        }
+
+        // every chunk is counted once and the whole parse is reported once
+        BOOST_CHECK_EQUAL(parallel.parses(), 1);
+        const ini::parse_stats expected = sequential.totals();
+        const ini::parse_stats stats = parallel.totals();
+        BOOST_CHECK_EQUAL(stats.lines, expected.lines);
+        BOOST_CHECK_EQUAL(stats.sections, expected.sections);
+        BOOST_CHECK_EQUAL(stats.values, expected.values);
+        BOOST_CHECK_EQUAL(stats.comments, expected.comments);
+        BOOST_CHECK_EQUAL(stats.bytes, text.size());
+    }
+
+    BOOST_AUTO_TEST_CASE(ConversionStatsTest)
+    {
+        ini::stats_collector collector;
+        observer_guard guard(&collector);
+
+        ini::File<std::string> file;
+        parse_text("[s]\nint = 42\ndouble = 2.5\nbad = abc\n", file);
+        const auto& section = file.at("s");
+        BOOST_CHECK_EQUAL(section.get<int>("int"), 42);
+        BOOST_CHECK_EQUAL(section.at("int").as_cached<int>(), 42);
+        BOOST_CHECK_EQUAL(section.at("int").as_cached<int>(), 42);
+        BOOST_CHECK_EQUAL(section.get<double>("double"), 2.5);
+        BOOST_CHECK_THROW(section.get<int>("bad"), ini::not_convertible);
+        BOOST_CHECK_EQUAL(section.get<int>("missing", 7), 7);
+
+        const auto conversions = collector.conversions();
+        BOOST_CHECK_EQUAL(conversions.size(), 2);
+        const auto& ints = conversions.at(std::type_index(typeid(int)));
+        BOOST_CHECK_EQUAL(ints.count, 3);
+        BOOST_CHECK_EQUAL(ints.failures, 1);
+        BOOST_CHECK_EQUAL(conversions.at(std::type_index(typeid(double))).count, 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(NoObserverTest)
+    {
+        ini::stats_collector collector;
+        {
+            observer_guard guard(&collector);
+        }
+        ini::File<std::string> file;
+        parse_text("[s]\nint = 42\n", file);
+        BOOST_CHECK_EQUAL(file.at("s").get<int>("int"), 42);
+        BOOST_CHECK_EQUAL(collector.parses(), 0);
+        BOOST_CHECK(collector.conversions().empty());
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
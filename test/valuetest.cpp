@@ -1,7 +1,11 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MAIN
 #include <boost/test/unit_test.hpp>
+#include <array>
 #include <iterator>
+#include <limits>
+#include <random>
+#include <thread>
 #include <vector>
 #include "value.h"
 #include "teststructures.h"
@@ -24,6 +28,49 @@ BOOST_AUTO_TEST_SUITE(ValueTestSuit)
         BOOST_CHECK_EQUAL(ini::Value().as<std::string>("default"), "default");
     }
 
+    BOOST_AUTO_TEST_CASE(NumberConversionTest)
+    {
+        BOOST_CHECK_EQUAL(ini::Value(" +42").as<int>(), 42);
+        BOOST_CHECK_EQUAL(ini::Value("-42 apples").as<long long>(), -42);
+        BOOST_CHECK_EQUAL(ini::Value("18446744073709551615").as<unsigned long long>(), 18446744073709551615ull);
+        BOOST_CHECK_THROW(ini::Value("2147483648").as<int>(), ini::not_convertible);
+        // unlike std::istream, negative numbers are not wrapped around into unsigned types
+        BOOST_CHECK_THROW(ini::Value("-1").as<unsigned>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("+-1").as<int>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("abc").as<double>(), ini::not_convertible);
+        BOOST_CHECK_EQUAL(ini::Value("1e-3").as<double>(), 0.001);
+        BOOST_CHECK_EQUAL(ini::Value("-.5").as<double>(), -0.5);
+        BOOST_CHECK_THROW(ini::Value("inf").as<double>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("-nan").as<double>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("infinity").as<float>(), ini::not_convertible);
+
+        BOOST_CHECK_EQUAL(ini::Value("1").as<bool>(), true);
+        BOOST_CHECK_EQUAL(ini::Value("0").as<bool>(), false);
+        BOOST_CHECK_EQUAL(ini::Value("true").as<bool>(), true);
+        BOOST_CHECK_EQUAL(ini::Value("false").as<bool>(), false);
+        BOOST_CHECK_THROW(ini::Value("2").as<bool>(), ini::not_convertible);
+        BOOST_CHECK_EQUAL(ini::Value("true ; comment").as<bool>(), true);
+        BOOST_CHECK_THROW(ini::Value("truex").as<bool>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("false_").as<bool>(), ini::not_convertible);
+
+        BOOST_CHECK_EQUAL(ini::Value(" x").as<char>(), 'x');
+        BOOST_CHECK(ini::wValue(L" +7").as<short>() == 7);
+
+        std::mt19937_64 gen(7);
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            double expected;
+            uint64_t bits = gen();
+            std::memcpy(&expected, &bits, sizeof(expected));
+            if(!std::isfinite(expected))
+                continue;
+            std::ostringstream oss;
+            oss.precision(std::numeric_limits<double>::max_digits10);
+            oss << expected;
+            BOOST_CHECK_EQUAL(ini::Value(oss.str()).as<double>(), expected);
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(ArrayTypeTest)
     {
         ini::Value arr("[1,2, 3, 4, 5, 6, 7, 8, 9, 10]");
@@ -46,6 +93,97 @@ BOOST_AUTO_TEST_SUITE(ValueTestSuit)
         BOOST_CHECK_EQUAL(mix_vec[2].as<std::string>(), "string");
     }
 
+    BOOST_AUTO_TEST_CASE(ArraySplitTest)
+    {
+        ini::Value quoted(R"([a, "b, c", "d]", "e \"f, g\"",h])");
+        auto vec = quoted.as<std::vector<std::string>>();
+        BOOST_REQUIRE_EQUAL(vec.size(), 5);
+        BOOST_CHECK_EQUAL(vec[1], "b, c");
+        BOOST_CHECK_EQUAL(vec[2], "d]");
+        BOOST_CHECK_EQUAL(vec[3], "e \"f, g\"");
+        BOOST_CHECK_EQUAL(vec[4], "h");
+
+        BOOST_CHECK(ini::Value("[1,,2\n3]").as<std::vector<int>>() == std::vector<int>({1, 2, 3}));
+        BOOST_CHECK(ini::Value("[]").as<std::vector<int>>().empty());
+        BOOST_CHECK_THROW(ini::Value("1, 2").as<std::vector<int>>(), ini::not_convertible);
+        BOOST_CHECK_THROW(ini::Value("[1, ]2]").as<std::vector<int>>(), ini::not_convertible);
+
+        auto arr = ini::Value("[1.5, 2.5, 3.5]").as<std::array<double, 3>>();
+        BOOST_CHECK_EQUAL(arr[2], 3.5);
+        BOOST_CHECK_THROW((ini::Value("[1, 2]").as<std::array<int, 3>>()), ini::not_convertible);
+        BOOST_CHECK_THROW((ini::Value("[1, 2, 3, 4]").as<std::array<int, 3>>()), ini::not_convertible);
+
+        int buffer[4];
+        BOOST_CHECK_EQUAL(ini::Value("[4, 3, 2]").as_array(buffer, 4), 3);
+        BOOST_CHECK_EQUAL(buffer[0], 4);
+        BOOST_CHECK_EQUAL(buffer[2], 2);
+        BOOST_CHECK_THROW(ini::Value("[1, 2, 3, 4, 5]").as_array(buffer, 4), ini::not_convertible);
+        BOOST_CHECK_EQUAL(ini::Value().as_array(buffer, 4), 0);
+
+        std::string big = "[";
+        for(int i = 0; i < 100000; ++i)
+            big += std::to_string(i) + ", ";
+        big += "100000]";
+        auto big_vec = ini::Value(big).as<std::vector<int>>();
+        BOOST_REQUIRE_EQUAL(big_vec.size(), 100001);
+        BOOST_CHECK_EQUAL(big_vec.capacity(), 100001);
+        BOOST_CHECK_EQUAL(big_vec.back(), 100000);
+        BOOST_CHECK_EQUAL(ini::Value(big).as<std::string>(), big);
+
+        BOOST_CHECK_EQUAL(ini::Value(R"(  "a \"b\" "  )").as<std::string>(), "a \"b\" ");
+        BOOST_CHECK_EQUAL(ini::Value(R"(""x")").as<std::string>(), "\"\"x\"");
+        BOOST_CHECK_EQUAL(ini::Value("a\nb").as<std::string>(), "");
+
+        const std::string views = "[one, two]";
+        auto view_vec = ini::ViewValue(views).as<std::vector<ini::ViewValue>>();
+        BOOST_REQUIRE_EQUAL(view_vec.size(), 2);
+        BOOST_CHECK_EQUAL(view_vec[1].as<std::string>(), "two");
+    }
+
+    BOOST_AUTO_TEST_CASE(CachedConversionTest)
+    {
+        ini::reset_conversion_cache_statistics();
+
+        ini::Value value("[1, 2, 3]");
+        const auto& vec = value.as_cached<std::vector<int>>();
+        BOOST_CHECK(vec == std::vector<int>({1, 2, 3}));
+        BOOST_CHECK_EQUAL(&value.as_cached<std::vector<int>>(), &vec);
+        BOOST_CHECK_EQUAL(value.as_cached<std::string>(), "[1, 2, 3]");
+
+        auto stats = ini::conversion_cache_statistics();
+        BOOST_CHECK_EQUAL(stats.hits, 1);
+        BOOST_CHECK_EQUAL(stats.misses, 2);
+
+        value = ini::Value("[4]");
+        BOOST_CHECK(value.as_cached<std::vector<int>>() == std::vector<int>({4}));
+        BOOST_CHECK_EQUAL(ini::conversion_cache_statistics().misses, 3);
+
+        ini::Value copy = value;
+        BOOST_CHECK(copy.as_cached<std::vector<int>>() == std::vector<int>({4}));
+        BOOST_CHECK_EQUAL(ini::conversion_cache_statistics().misses, 4);
+
+        ini::Value number("42");
+        BOOST_CHECK_THROW(ini::Value("abc").as_cached<int>(), ini::not_convertible);
+
+        std::vector<std::thread> threads;
+        std::atomic<size_t> wrong{0};
+        for(size_t i = 0; i < 8; ++i)
+            threads.emplace_back([&]
+            {
+                for(size_t j = 0; j < 10000; ++j)
+                {
+                    if(number.as_cached<int>() != 42 || number.as_cached<double>() != 42.0)
+                        ++wrong;
+                }
+            });
+        for(auto& thread: threads)
+            thread.join();
+        BOOST_CHECK_EQUAL(wrong, 0);
+
+        stats = ini::conversion_cache_statistics();
+        BOOST_CHECK_EQUAL(stats.hits + stats.misses, 1 + 2 + 2 + 1 + 8 * 10000 * 2);
+    }
+
     BOOST_AUTO_TEST_CASE(CustomTypeTest)
     {
         ini::Value value("42");
@@ -84,4 +222,28 @@ BOOST_AUTO_TEST_SUITE(ValueTestSuit)
             BOOST_CHECK_EQUAL(vec[i], i + 1);
     }
 
+    BOOST_AUTO_TEST_CASE(ViewValueTest)
+    {
+        const std::string str = "12.5";
+        ini::ViewValue value(str);
+
+        BOOST_CHECK_EQUAL(value.as<std::string>(), "12.5");
+        BOOST_CHECK_EQUAL(value.as<double>(), 12.5);
+        BOOST_CHECK_EQUAL(value.as<int>(), 12);
+        BOOST_CHECK_EQUAL(value.as<A>().val, 12);
+
+        const std::string quoted = R"( "some \"string" )";
+        BOOST_CHECK_EQUAL(ini::ViewValue(quoted).as<std::string>(), "some \"string");
+
+        const std::string arr = "[1, 2, 3]";
+        BOOST_CHECK(ini::ViewValue(arr).as<std::vector<int>>() == std::vector<int>({1, 2, 3}));
+
+        BOOST_CHECK_EQUAL(ini::ViewValue().as<int>(), 0);
+        BOOST_CHECK_EQUAL(ini::ViewValue().as<std::string>("default"), "default");
+        BOOST_CHECK_THROW(ini::ViewValue(std::string_view("abc")).as<int>(), ini::not_convertible);
+
+        const std::wstring wstr = L"42";
+        BOOST_CHECK_EQUAL(ini::wViewValue(wstr).as<int>(), 42);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file